@@ -0,0 +1,94 @@
+#pragma once
+#include "Utils.hpp"
+
+/**
+ * @class AABB
+ * @brief Axis-Aligned Bounding Box used by the acceleration structures.
+ *
+ * A box is stored as two corners (minimum, maximum). A default-constructed
+ * box is "empty" (minimum = +inf, maximum = -inf) so that it can be grown
+ * with `expand()` without special-casing the first element.
+ *
+ * The ray test uses the classic slab method: the ray is clipped against the
+ * three pairs of parallel planes and the box is hit if the resulting
+ * parameter interval is non-empty.
+ */
+class AABB {
+public:
+    Point3 minimum; // Lower corner
+    Point3 maximum; // Upper corner
+
+    AABB() : minimum(infinity, infinity, infinity), maximum(-infinity, -infinity, -infinity) {}
+    AABB(const Point3& a, const Point3& b) : minimum(a), maximum(b) {}
+
+    // Grow the box so that it also encloses the point p
+    void expand(const Point3& p) {
+        for (int a = 0; a < 3; ++a) {
+            minimum[a] = fmin(minimum[a], p[a]);
+            maximum[a] = fmax(maximum[a], p[a]);
+        }
+    }
+
+    // Grow the box so that it also encloses the box b
+    void expand(const AABB& b) {
+        for (int a = 0; a < 3; ++a) {
+            minimum[a] = fmin(minimum[a], b.minimum[a]);
+            maximum[a] = fmax(maximum[a], b.maximum[a]);
+        }
+    }
+
+    /**
+     * @brief Enlarges degenerate (flat) axes to a minimal thickness.
+     * Axis-aligned parallelograms produce boxes of zero width along one axis,
+     * which makes the slab test numerically fragile.
+     */
+    void pad(double delta = 1e-4) {
+        for (int a = 0; a < 3; ++a) {
+            if (maximum[a] - minimum[a] < delta) {
+                minimum[a] -= delta / 2;
+                maximum[a] += delta / 2;
+            }
+        }
+    }
+
+    bool empty() const { return minimum[0] > maximum[0]; }
+
+    Point3 centroid() const { return 0.5 * (minimum + maximum); }
+
+    // Index (0,1,2) of the axis along which the box is the widest
+    int longest_axis() const {
+        Vec3 d = maximum - minimum;
+        if (d[0] > d[1] && d[0] > d[2]) return 0;
+        return d[1] > d[2] ? 1 : 2;
+    }
+
+    // Surface area of the box, used by the surface area heuristic (SAH)
+    double surface_area() const {
+        if (empty()) return 0.0;
+        Vec3 d = maximum - minimum;
+        return 2.0 * (d[0] * d[1] + d[1] * d[2] + d[2] * d[0]);
+    }
+
+    /**
+     * @brief Slab test: does the ray cross the box inside [t_min, t_max]?
+     */
+    bool hit(const Ray& r, double t_min, double t_max) const {
+        for (int a = 0; a < 3; ++a) {
+            auto inv_d = 1.0 / r.direction()[a];
+            auto t0 = (minimum[a] - r.origin()[a]) * inv_d;
+            auto t1 = (maximum[a] - r.origin()[a]) * inv_d;
+            if (inv_d < 0.0) std::swap(t0, t1);
+            t_min = t0 > t_min ? t0 : t_min;
+            t_max = t1 < t_max ? t1 : t_max;
+            if (t_max < t_min) return false;
+        }
+        return true;
+    }
+};
+
+// The smallest box enclosing both a and b
+inline AABB surrounding_box(const AABB& a, const AABB& b) {
+    AABB box = a;
+    box.expand(b);
+    return box;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <string>
+#include <stdexcept>
+#include "BVH.hpp"
+#include "WideBVH.hpp"
+
+/**
+ * @brief Acceleration structures the renderer can trace against.
+ *
+ * Both are drop-in replacements for the flat Scene and share the same
+ * primitive storage and leaf intersection code, so they can be A/B tested
+ * on the same scene by switching the type at runtime.
+ */
+enum class AcceleratorType {
+    Binary, // Binary SAH BVH (BVH)
+    Wide4   // 4-wide BVH with SIMD box tests (WideBVH)
+};
+
+/**
+ * @brief Parses an accelerator name ("bvh2"/"binary" or "bvh4"/"wide").
+ * @throw std::invalid_argument if the name is unknown.
+ */
+inline AcceleratorType parse_accelerator_type(const std::string& name) {
+    if (name == "bvh2" || name == "binary") return AcceleratorType::Binary;
+    if (name == "bvh4" || name == "wide") return AcceleratorType::Wide4;
+    throw std::invalid_argument("Unknown accelerator type: " + name);
+}
+
+inline const char* accelerator_name(AcceleratorType type) {
+    return type == AcceleratorType::Wide4 ? "bvh4" : "bvh2";
+}
+
+/**
+ * @brief Builds the requested acceleration structure over a scene.
+ */
+inline shared_ptr<SceneBaseObject> build_accelerator(const Scene& scene, AcceleratorType type) {
+    if (type == AcceleratorType::Wide4) return make_shared<WideBVH>(scene);
+    return make_shared<BVH>(scene);
+}
@@ -0,0 +1,193 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "Scene.hpp"
+#include "SphereSoA.hpp"
+
+/**
+ * @struct LinearBVHNode
+ * @brief A node of the flattened BVH, packed into 32 bytes (two nodes per cache line).
+ *
+ * Nodes are stored in depth-first order in one contiguous array:
+ * - the first child of an interior node is always the next node in the array,
+ *   so only the offset of the second child is stored;
+ * - a leaf stores the range [primitives_offset, primitives_offset + primitive_count)
+ *   in the array of its primitive kind (all primitives of a leaf share one kind).
+ *
+ * Bounds are stored in single precision and rounded outwards, so a ray never
+ * misses a box that the double precision box would have reported as hit.
+ */
+struct alignas(32) LinearBVHNode {
+    float bounds_min[3];
+    float bounds_max[3];
+    union {
+        uint32_t primitives_offset;   // Leaf: first primitive
+        uint32_t second_child_offset; // Interior: index of the second child
+    };
+    uint16_t primitive_count;         // 0 for interior nodes
+    uint8_t axis;                     // Interior: split axis, used to visit the near child first
+    uint8_t kind;                     // Leaf: PrimitiveKind of the primitives
+
+    /**
+     * @brief Slab test against the node bounds.
+     * @param origin The ray origin.
+     * @param inv_dir Component-wise inverse of the ray direction.
+     */
+    inline bool hit(const Point3& origin, const Vec3& inv_dir, double t_min, double t_max) const {
+        for (int a = 0; a < 3; ++a) {
+            double t0 = (bounds_min[a] - origin[a]) * inv_dir[a];
+            double t1 = (bounds_max[a] - origin[a]) * inv_dir[a];
+            if (inv_dir[a] < 0.0) std::swap(t0, t1);
+            t_min = t0 > t_min ? t0 : t_min;
+            t_max = t1 < t_max ? t1 : t_max;
+            if (t_max < t_min) return false;
+        }
+        return true;
+    }
+};
+
+static_assert(sizeof(LinearBVHNode) == 32, "LinearBVHNode must stay 32 bytes");
+
+
+/**
+ * @class BVH
+ * @brief Drop-in replacement for a flat Scene, accelerated by a BVH.
+ *
+ * The constructor flattens the given Scene (a Parallelepiped contributes its
+ * six faces as individual primitives) and builds the hierarchy top-down with
+ * the Surface Area Heuristic (SAH): at each level the primitives are binned
+ * along each axis and the split minimising
+ *
+ *      C = C_trav + (A_left * N_left + A_right * N_right) / A_node
+ *
+ * is chosen, or a leaf is made when that is cheaper than splitting.
+ *
+ * The tree is emitted directly as a LinearBVHNode array, and the primitives
+ * are copied by value into one array per kind, in leaf order. Traversal uses
+ * a small fixed-size stack and calls the primitives' hit() non-virtually.
+ * Spheres are stored as a SphereSoA, and the spheres of a leaf (padded to the
+ * SIMD width) are tested together by its batched kernel.
+ *
+ * Unbounded objects (infinite Planes) cannot be put in a box, so they are
+ * kept outside the tree and tested linearly before it.
+ *
+ * `occluded()` walks the same tree for shadow rays, without ordering the
+ * children, and returns as soon as any primitive is hit.
+ *
+ * `hit_packet()` walks the tree once for a packet of rays with a common origin
+ * (camera rays). A node is skipped when the packet's interval test rejects it,
+ * or else when no ray from the first active one onwards hits it; that first
+ * active ray is kept on the stack with the node, so rays that left a subtree
+ * are not tested again below it. Leaves are intersected ray by ray.
+ */
+class BVH : public SceneBaseObject {
+public:
+    // Kind of the primitives referenced by a leaf
+    enum PrimitiveKind : uint8_t {
+        SpherePrimitive,        // Index into spheres (SoA)
+        ParallelogramPrimitive, // Index into parallelograms
+        GenericPrimitive        // Any other bounded object, tested through its virtual hit()
+    };
+
+    static constexpr int max_leaf_size = 4;  // Maximum number of primitives in a leaf (sphere-only leaves: two SIMD batches)
+    static constexpr int stack_size = 64;    // Traversal stack; the builder keeps the depth below it
+
+    explicit BVH(const Scene& scene);
+
+    virtual bool hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const override;
+    virtual bool occluded(const Ray& r, double t_min, double t_max) const override;
+    virtual void hit_packet(const RayPacket& packet, double t_min, double t_max, HitRecord* recs, bool* hits) const override;
+    virtual bool bounding_box(AABB& output_box) const override;
+
+    // Number of bounded primitives stored in the tree
+    size_t primitive_count() const { return num_primitives; }
+    // Number of nodes of the flattened tree
+    size_t node_count() const { return nodes.size(); }
+
+private:
+    friend class WideBVH;    // Collapses this tree and reuses its leaves
+    friend class SceneCache; // Saves the built tree and reloads it without rebuilding
+
+    BVH() = default;         // Empty tree, filled by SceneCache
+
+    // Per-primitive data cached during construction
+    struct BuildPrimitive {
+        shared_ptr<SceneBaseObject> object;
+        PrimitiveKind kind;
+        AABB box;
+        Point3 centroid;
+    };
+
+    void collect_primitives(const shared_ptr<SceneBaseObject>& object,
+                            std::vector<BuildPrimitive>& primitives);
+    uint32_t build(std::vector<BuildPrimitive>& primitives, size_t start, size_t end, int depth);
+    uint32_t make_leaf(std::vector<BuildPrimitive>& primitives, size_t start, size_t end, const AABB& bounds);
+    uint32_t add_node(const AABB& bounds);
+
+    // Intersects the primitives of a leaf, shrinking t_max on every hit
+    inline bool hit_leaf(const LinearBVHNode& node, const Ray& r, double t_min, double t_max, HitRecord& rec) const {
+        bool hit_anything = false;
+        uint32_t end = node.primitives_offset + node.primitive_count;
+
+        // Qualified calls: the concrete type is known, so no virtual dispatch is needed
+        switch (node.kind) {
+        case SpherePrimitive: {
+            // Sphere leaves are padded to the SIMD width: test them all at once
+            uint32_t padded = (node.primitive_count + SphereSoA::lane_width - 1) / SphereSoA::lane_width * SphereSoA::lane_width;
+            int index = spheres.nearest_hit(r, node.primitives_offset, padded, t_min, t_max);
+            if (index >= 0) {
+                spheres.fill_record(index, r, t_max, rec);
+                hit_anything = true;
+            }
+            break;
+        }
+        case ParallelogramPrimitive:
+            for (uint32_t i = node.primitives_offset; i < end; ++i) {
+                if (parallelograms[i].Parallelogram::hit(r, t_min, t_max, rec)) {
+                    hit_anything = true;
+                    t_max = rec.t;
+                }
+            }
+            break;
+        default:
+            for (uint32_t i = node.primitives_offset; i < end; ++i) {
+                if (generics[i]->hit(r, t_min, t_max, rec)) {
+                    hit_anything = true;
+                    t_max = rec.t;
+                }
+            }
+            break;
+        }
+        return hit_anything;
+    }
+
+    // Checks if any primitive of a leaf is hit within [t_min, t_max]
+    inline bool occluded_leaf(const LinearBVHNode& node, const Ray& r, double t_min, double t_max) const {
+        uint32_t end = node.primitives_offset + node.primitive_count;
+
+        switch (node.kind) {
+        case SpherePrimitive: {
+            uint32_t padded = (node.primitive_count + SphereSoA::lane_width - 1) / SphereSoA::lane_width * SphereSoA::lane_width;
+            return spheres.any_hit(r, node.primitives_offset, padded, t_min, t_max);
+        }
+        case ParallelogramPrimitive:
+            for (uint32_t i = node.primitives_offset; i < end; ++i) {
+                if (parallelograms[i].Parallelogram::occluded(r, t_min, t_max)) return true;
+            }
+            return false;
+        default:
+            for (uint32_t i = node.primitives_offset; i < end; ++i) {
+                if (generics[i]->occluded(r, t_min, t_max)) return true;
+            }
+            return false;
+        }
+    }
+
+    std::vector<LinearBVHNode> nodes;                   // Flattened tree, depth-first order
+    SphereSoA spheres;                                  // Sphere primitives in leaf order
+    std::vector<Parallelogram> parallelograms;          // Parallelogram primitives in leaf order
+    std::vector<shared_ptr<SceneBaseObject>> generics;  // Other bounded primitives in leaf order
+    std::vector<shared_ptr<SceneBaseObject>> unbounded; // Infinite objects (Planes)
+    size_t num_primitives = 0;
+};
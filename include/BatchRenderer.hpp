@@ -0,0 +1,81 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <ostream>
+#include "Accelerator.hpp"
+#include "RenderUtils.hpp"
+
+/**
+ * @struct BatchSettings
+ * @brief Render settings shared by every scene of a batch.
+ */
+struct BatchSettings {
+    std::string output_dir = ".";  // Images are written as <output_dir>/<scene name>.png
+    int image_width = 400;
+    int samples_per_pixel = 400;
+    int max_depth = 50;
+    int rr_min_depth = 3;
+    int num_threads = 1;
+    AcceleratorType accel = AcceleratorType::Binary;
+    SamplerType sampler = SamplerType::Sobol;
+    RenderEngine engine = RenderEngine::Megakernel;
+};
+
+/**
+ * @struct BatchJobReport
+ * @brief What happened to one scene of a batch, with the timing of each phase in seconds.
+ */
+struct BatchJobReport {
+    std::string scene_path;
+    std::string output_path;
+    std::string error;    // Non-empty if the scene could not be loaded or saved
+    size_t objects = 0;
+    int image_width = 0;
+    int image_height = 0;
+    double parse = 0.0;   // Parsing the XML file
+    double build = 0.0;   // Scene conversion, acceleration structure, lights
+    double start = 0.0;   // When the first tile started, since the start of the render phase
+    double render = 0.0;  // From the first tile started to the last tile finished (wall clock)
+    double busy = 0.0;    // Sum of the tile times over all threads (thread seconds)
+    double encode = 0.0;  // Resolving the film and writing the PNG
+};
+
+/**
+ * @brief Lists the scenes of a batch.
+ * @param source A directory (all its .xml files, sorted by name) or a manifest file (one
+ *               scene path per line, relative to the manifest; empty lines and # comments ignored).
+ * @throw std::runtime_error if the source cannot be read.
+ */
+std::vector<std::string> collect_batch_scenes(const std::string& source);
+
+/**
+ * @brief Renders a batch of scenes over one shared pool of threads.
+ *
+ * All the scenes are parsed and built up front, in parallel (one scene per
+ * thread at a time). The jobs are then sorted by estimated cost (pixels x spp
+ * x log of the primitive count), largest first, and every thread walks that
+ * list: it renders tiles of the first job that still has some, and moves on
+ * to the next job as soon as none is left, while the other threads finish the
+ * last tiles. Large scenes thus get all the cores, the tail of a job overlaps
+ * the start of the next one, and small scenes end up rendered concurrently,
+ * so no core idles between jobs. The thread that finishes the last tile of a
+ * job encodes its PNG.
+ *
+ * A job's film is only allocated when the first thread enters it, and once its
+ * PNG is written everything but its report (film, scene, accelerator, lights)
+ * is freed, so only the jobs being rendered hold an image in memory.
+ *
+ * @param scenes The scene files, e.g. from collect_batch_scenes().
+ * @param settings The render settings of every job.
+ * @param log Receives progress messages (one line per finished or failed job).
+ * @return One report per scene, in the order of `scenes`.
+ */
+std::vector<BatchJobReport> render_batch(const std::vector<std::string>& scenes,
+                                         const BatchSettings& settings, std::ostream& log);
+
+/**
+ * @brief Prints one key=value line per job, then a line with the batch totals.
+ * @param wall_seconds Wall-clock time of the whole batch.
+ */
+void print_batch_summary(const std::vector<BatchJobReport>& reports, const BatchSettings& settings,
+                         double wall_seconds, std::ostream& out);
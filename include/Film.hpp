@@ -0,0 +1,167 @@
+#pragma once
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include "Utils.hpp"
+
+// Pixel structure (gamma-corrected, 0-255 per channel)
+struct Pixel { int r, g, b; };
+
+/**
+ * @struct AdaptiveSampling
+ * @brief Stopping rule of adaptive sampling.
+ *
+ * A pixel stops receiving samples once the standard error of its displayed
+ * brightness falls below `target_error`. The error is measured after gamma
+ * correction (sqrt), where 1/256 is one step of the 8-bit output: the same
+ * noise is more visible in dark pixels than in bright ones.
+ */
+struct AdaptiveSampling {
+    double target_error = 1.0 / 256; // Standard error of the displayed luminance, in [0, 1]
+    int min_samples = 64;            // Samples before the variance estimate is trusted
+    int max_samples = 3200;          // Cap for the noisiest pixels
+};
+
+/**
+ * @class Film
+ * @brief A floating-point image that accumulates radiance samples.
+ *
+ * Each pixel keeps the running sum of its samples and its own sample count,
+ * so the image can keep receiving samples pass after pass (progressive
+ * rendering) and be resolved to 8-bit at any time. Because the count is per
+ * pixel, a pass interrupted halfway still resolves correctly: every pixel is
+ * simply the average of the samples it received.
+ *
+ * The luminance of every sample is also accumulated with its square, which
+ * gives a running variance estimate per pixel for adaptive sampling.
+ *
+ * Different threads may add samples to different pixels concurrently.
+ */
+class Film {
+public:
+    Film(int image_width, int image_height)
+        : w(image_width), h(image_height),
+          sum(static_cast<size_t>(image_width) * image_height, Color(0,0,0)),
+          lum_sum(static_cast<size_t>(image_width) * image_height, 0.0),
+          lum_sq_sum(static_cast<size_t>(image_width) * image_height, 0.0),
+          count(static_cast<size_t>(image_width) * image_height, 0) {}
+
+    // Luminance (Rec. 709) clamped to the displayable range, used for the error estimate
+    static double luminance(const Color& c) {
+        return clamp(0.2126 * c.x() + 0.7152 * c.y() + 0.0722 * c.z(), 0.0, 1.0);
+    }
+
+    int width() const { return w; }
+    int height() const { return h; }
+
+    /**
+     * @brief Adds samples to pixel (i, j) (row j from the top).
+     * @param sample_sum Sum of the radiance of the samples.
+     * @param luminance_sum Sum of luminance() of the samples.
+     * @param luminance_sq_sum Sum of the squared luminance() of the samples.
+     * @param samples Number of samples.
+     */
+    void add(int i, int j, const Color& sample_sum, double luminance_sum, double luminance_sq_sum, int samples) {
+        size_t idx = static_cast<size_t>(j) * w + i;
+        sum[idx] += sample_sum;
+        lum_sum[idx] += luminance_sum;
+        lum_sq_sum[idx] += luminance_sq_sum;
+        count[idx] += samples;
+    }
+
+    int samples(int i, int j) const { return count[static_cast<size_t>(j) * w + i]; }
+
+    // Total number of samples in the film
+    long long total_samples() const {
+        long long total = 0;
+        for (int n : count) total += n;
+        return total;
+    }
+
+    /**
+     * @brief Standard error of the displayed (gamma-corrected) luminance of pixel (i, j).
+     * Infinite below two samples. With y = sqrt(L), the error of the mean of L is
+     * divided by dy/dL = 2 sqrt(L); the mean is floored so that black pixels still converge.
+     */
+    double display_error(int i, int j) const {
+        size_t idx = static_cast<size_t>(j) * w + i;
+        int n = count[idx];
+        if (n < 2) return std::numeric_limits<double>::infinity();
+        double mean = lum_sum[idx] / n;
+        double variance = std::max(0.0, (lum_sq_sum[idx] - n * mean * mean) / (n - 1));
+        return sqrt(variance / n) / (2.0 * sqrt(std::max(mean, 1e-3)));
+    }
+
+    // True once pixel (i, j) needs no more samples
+    bool converged(int i, int j, const AdaptiveSampling& adaptive) const {
+        int n = samples(i, j);
+        if (n >= adaptive.max_samples) return true;
+        return n >= adaptive.min_samples && display_error(i, j) <= adaptive.target_error;
+    }
+
+    // Number of pixels that still need samples
+    int active_pixels(const AdaptiveSampling& adaptive) const {
+        int active = 0;
+        for (int j = 0; j < h; ++j)
+            for (int i = 0; i < w; ++i)
+                if (!converged(i, j, adaptive)) ++active;
+        return active;
+    }
+
+    // Mean radiance of pixel (i, j), black if it has no sample yet
+    Color average(int i, int j) const {
+        size_t idx = static_cast<size_t>(j) * w + i;
+        return count[idx] > 0 ? sum[idx] / count[idx] : Color(0,0,0);
+    }
+
+    // Gamma-corrected (gamma 2) and clamped 8-bit value of pixel (i, j)
+    Pixel pixel(int i, int j) const {
+        Color c = average(i, j);
+        return {static_cast<int>(256 * clamp(sqrt(c.x()), 0.0, 0.999)),
+                static_cast<int>(256 * clamp(sqrt(c.y()), 0.0, 0.999)),
+                static_cast<int>(256 * clamp(sqrt(c.z()), 0.0, 0.999))};
+    }
+
+    /**
+     * @brief Resolves the pixels of [x0, x1) x [y0, y1) into an RGB image of the whole film.
+     * @param rgb Output, 3 bytes per pixel, width() * height() pixels, rows from the top.
+     */
+    void write_rgb(int x0, int y0, int x1, int y1, unsigned char* rgb) const {
+        for (int j = y0; j < y1; ++j) {
+            for (int i = x0; i < x1; ++i) {
+                Pixel p = pixel(i, j);
+                unsigned char* out = rgb + (static_cast<size_t>(j) * w + i) * 3;
+                out[0] = static_cast<unsigned char>(p.r);
+                out[1] = static_cast<unsigned char>(p.g);
+                out[2] = static_cast<unsigned char>(p.b);
+            }
+        }
+    }
+
+    void write_rgb(unsigned char* rgb) const { write_rgb(0, 0, w, h, rgb); }
+
+    /**
+     * @brief Writes the sample count of every pixel as a false-color RGB image.
+     * Black (no sample) -> blue -> red -> yellow -> white (`max_spp` samples or more).
+     * @param rgb Output, 3 bytes per pixel, width() * height() pixels, rows from the top.
+     */
+    void write_spp_heatmap(int max_spp, unsigned char* rgb) const {
+        static const double ramp[5][3] = {{0, 0, 0}, {0, 0, 1}, {1, 0, 0}, {1, 1, 0}, {1, 1, 1}};
+        for (size_t idx = 0; idx < count.size(); ++idx) {
+            double t = clamp(static_cast<double>(count[idx]) / std::max(1, max_spp), 0.0, 1.0) * 4.0;
+            int k = std::min(3, static_cast<int>(t));
+            double f = t - k;
+            for (int c = 0; c < 3; ++c) {
+                double value = ramp[k][c] + (ramp[k + 1][c] - ramp[k][c]) * f;
+                rgb[idx * 3 + c] = static_cast<unsigned char>(255.0 * value + 0.5);
+            }
+        }
+    }
+
+private:
+    int w, h;                // Image size in pixels
+    std::vector<Color> sum;          // Sum of the samples of each pixel
+    std::vector<double> lum_sum;     // Sum of the sample luminances of each pixel
+    std::vector<double> lum_sq_sum;  // Sum of the squared sample luminances of each pixel
+    std::vector<int> count;          // Number of samples of each pixel
+};
@@ -6,9 +6,11 @@
 #include <FL/Fl_Button.H>
 #include <FL/Fl_Hold_Browser.H>
 #include <FL/Fl_Progress.H>
+#include <FL/Fl_Check_Button.H>
 #include <FL/Fl_Native_File_Chooser.H>
 #include <FL/fl_ask.H>
 #include <string>
+#include <vector>
 
 // 全局状态结构体（需暴露给main.cpp）
 struct AppState {
@@ -21,6 +23,13 @@ struct AppState {
     Fl_Box* status_box = nullptr;
     Fl_Hold_Browser* file_browser = nullptr; // 新增：左侧文件列表框
     Fl_Progress* progress_bar = nullptr; // 新增：渲染进度条
+    Fl_Check_Button* progressive_check = nullptr; // 新增：渐进式渲染开关
+    Fl_Check_Button* adaptive_check = nullptr; // 新增：自适应采样开关
+    std::vector<unsigned char> spp_heatmap; // 新增：自适应采样热力图（RGB，与渲染缓冲区同尺寸，空表示没有）
+    Fl_Button* refresh_button = nullptr; // 底部按钮（main.cpp通过这些指针重新绑定回调）
+    Fl_Button* render_button = nullptr;
+    Fl_Button* save_button = nullptr;
+    Fl_Button* cancel_button = nullptr;
 };
 
 // 全局状态（extern供main.cpp访问）
@@ -36,6 +45,7 @@ void cleanup_resources(Fl_Window* win);
 void save_png_cb(Fl_Widget*, void*);
 void select_file_cb(Fl_Widget*, void*);
 void render_cb(Fl_Widget*, void*);
+void cancel_cb(Fl_Widget*, void*);
 
 // 状态栏接口
 void set_status(const std::string& msg, Fl_Color color = FL_BLACK);
@@ -0,0 +1,178 @@
+#pragma once
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+#include "Material.hpp"
+#include "Light.hpp"
+#include "Sampler.hpp"
+
+/**
+ * @brief The ways of scheduling the path tracer over the pixels of a tile.
+ *
+ * Both trace the same paths with the same random numbers (see shade_hit), so
+ * they produce the same image and can be A/B tested by switching at runtime.
+ */
+enum class RenderEngine {
+    Megakernel, // Each sample is traced to its end by ray_color (depth-first)
+    Wavefront   // Batches of paths advance one bounce at a time (render_blocks_wavefront)
+};
+
+/**
+ * @brief Parses an engine name ("megakernel"/"depth" or "wavefront"/"breadth").
+ * @throw std::invalid_argument if the name is unknown.
+ */
+inline RenderEngine parse_render_engine(const std::string& name) {
+    if (name == "megakernel" || name == "depth") return RenderEngine::Megakernel;
+    if (name == "wavefront" || name == "breadth") return RenderEngine::Wavefront;
+    throw std::invalid_argument("Unknown render engine: " + name);
+}
+
+inline const char* render_engine_name(RenderEngine engine) {
+    return engine == RenderEngine::Wavefront ? "wavefront" : "megakernel";
+}
+
+// Sampler dimensions of a path: the camera block, then one block per bounce.
+// The Sobol sampler stratifies groups of four dimensions, so the 2D pairs start a group.
+constexpr int camera_dimensions = 4;  // Pixel jitter (2), unused (2)
+constexpr int bounce_dimensions = 8;  // Light position (2), light choice, Russian roulette, scattering (4)
+
+/**
+ * @struct PathState
+ * @brief A path being traced: the ray to follow next and what the path carries.
+ */
+struct PathState {
+    Ray ray;                   // Ray to trace for the next bounce
+    Color radiance{0,0,0};     // Light gathered along the path
+    Color throughput{1,1,1};   // Attenuation accumulated since the camera
+    int depth = 0;             // Bounces done so far
+
+    // Previous bounce, needed to weight emission found by BSDF sampling
+    bool prev_diffuse = false; // Whether lights were also sampled explicitly there
+    double prev_pdf = 0.0;     // Density of the scattered direction
+    Point3 prev_p;             // Position of the bounce
+};
+
+/**
+ * @struct ShadowRay
+ * @brief Direct light found by next-event estimation, pending a visibility test.
+ */
+struct ShadowRay {
+    bool pending = false; // Whether a shadow ray must be traced at all
+    Ray ray;              // From the hit point towards the light
+    double t_max = 0.0;   // Just before the surface of the light
+    Color contribution;   // Added to the path's radiance if nothing blocks the ray
+};
+
+/**
+ * @brief Next-event estimation: light reaching a diffuse hit point directly from a light.
+ *
+ * One emissive sphere is chosen uniformly and a direction towards it is sampled.
+ * The contribution is weighted by multiple importance sampling (power heuristic)
+ * against the BSDF sampling of the material, which could have produced the same
+ * direction. The shadow ray is only returned, so that the caller can trace it
+ * immediately or together with others.
+ *
+ * @param rec The diffuse hit point.
+ * @param material The material at the hit point (is_diffuse() must be true).
+ * @param sampler Provides the point on the light (2D) and the choice of the light (1D).
+ * @param shadow Receives the shadow ray and the reflected direct light, before
+ *               multiplication by the path throughput.
+ * @return false if the light cannot contribute (no shadow ray to trace).
+ */
+inline bool sample_direct_light(const HitRecord& rec, const Material& material, const MaterialTable& materials,
+                                const LightList& lights, Sampler& sampler, ShadowRay& shadow) {
+    double u1, u2;
+    sampler.get_2d(u1, u2);
+    size_t index = std::min(static_cast<size_t>(sampler.get_1d() * lights.size()), lights.size() - 1);
+    const SphereLight& light = lights.lights[index];
+
+    Vec3 wi;
+    double distance, cone_pdf;
+    if (!light.sample(rec.p, u1, u2, wi, distance, cone_pdf))
+        return false;
+
+    Color f = material.eval(rec, wi);
+    if (f.length_squared() == 0)
+        return false; // The light is behind the surface
+
+    double light_pdf = cone_pdf / lights.size();
+    double weight = power_heuristic(light_pdf, material.pdf(rec, wi));
+    Color emitted = materials[light.mat_id].emit(rec.p + distance * wi);
+
+    // Shadow ray, stopped just before the surface of the light (any blocker will do)
+    shadow.ray = Ray(rec.p, wi);
+    shadow.t_max = distance * (1.0 - 1e-4);
+    shadow.contribution = f * emitted * (weight / light_pdf);
+    return true;
+}
+
+/**
+ * @brief One bounce of the path tracer, at the point where path.ray hit the scene.
+ *
+ * Adds the emission of the hit point (MIS-weighted if the previous bounce also
+ * sampled the lights), samples a light at diffuse hits, scatters the ray and
+ * applies Russian roulette once `rr_min_depth` bounces are done; surviving paths
+ * are divided by their survival probability, so the estimate stays unbiased.
+ *
+ * Each bounce reads its random numbers from its own block of sampler dimensions,
+ * at fixed offsets for each use, so the result does not depend on the order in
+ * which the paths of an image are advanced.
+ *
+ * @param path The path; on return its ray is the scattered ray and depth is incremented.
+ * @param rec The hit of path.ray.
+ * @param shadow Receives the direct light of this bounce (pending == false if none), already
+ *               multiplied by the throughput: the caller adds it unless the shadow ray is blocked.
+ * @return true if the path continues; false if it was absorbed or terminated.
+ */
+inline bool shade_hit(PathState& path, const HitRecord& rec, const MaterialTable& materials,
+                      const LightList& lights, int rr_min_depth, Sampler& sampler, ShadowRay& shadow) {
+    const int dims = camera_dimensions + path.depth * bounce_dimensions; // This bounce's sampler block
+
+    // Get the self-illuminated color of the object itself
+    // Black for ordinary objects, bright color for light sources
+    const Material& material = materials[rec.mat_id];
+    Color emitted = material.emit(rec.p);
+    if (path.prev_diffuse && material.is_emissive()) {
+        int light = lights.find(rec.mat_id, rec.p);
+        if (light >= 0)
+            emitted = emitted * power_heuristic(path.prev_pdf, lights.pdf(light, path.prev_p));
+    }
+    path.radiance += path.throughput * emitted;
+
+    // Direct lighting from a sampled light
+    shadow.pending = false;
+    if (material.is_diffuse() && !lights.empty()) {
+        sampler.start_dimensions(dims, 3);
+        shadow.pending = sample_direct_light(rec, material, materials, lights, sampler, shadow);
+        if (shadow.pending) shadow.contribution = path.throughput * shadow.contribution;
+    }
+
+    // Attempt to scatter (reflection/refraction)
+    // If no scattering (e.g., hit a light), the path ends here
+    Ray scattered;
+    Color attenuation;
+    sampler.start_dimensions(dims + 4, 4);
+    if (!material.scatter(path.ray, rec, attenuation, scattered, sampler))
+        return false;
+
+    path.prev_diffuse = material.is_diffuse();
+    if (path.prev_diffuse) {
+        path.prev_pdf = material.pdf(rec, unit_vector(scattered.direction()));
+        path.prev_p = rec.p;
+    }
+
+    path.throughput = path.throughput * attenuation;
+
+    // Russian roulette: survive with probability p, and compensate by 1/p
+    if (path.depth + 1 >= rr_min_depth) {
+        double p = std::min(0.95, std::max({path.throughput.x(), path.throughput.y(), path.throughput.z()}));
+        sampler.start_dimensions(dims + 3, 1);
+        if (sampler.get_1d() >= p)
+            return false;
+        path.throughput = path.throughput / p;
+    }
+
+    path.ray = scattered;
+    ++path.depth;
+    return true;
+}
@@ -0,0 +1,123 @@
+#pragma once
+#include <vector>
+#include "Scene.hpp"
+
+/**
+ * @brief Power heuristic (beta = 2) for multiple importance sampling.
+ * @param pdf_a Density of the strategy that generated the sample.
+ * @param pdf_b Density of the other strategy for the same sample.
+ * @return The weight of the sample for strategy a.
+ */
+inline double power_heuristic(double pdf_a, double pdf_b) {
+    double a2 = pdf_a * pdf_a;
+    double b2 = pdf_b * pdf_b;
+    return a2 + b2 > 0 ? a2 / (a2 + b2) : 0.0;
+}
+
+
+/**
+ * @struct SphereLight
+ * @brief An emissive sphere that can be sampled explicitly (next-event estimation).
+ *
+ * Seen from a point p outside of it, a sphere covers a cone of directions of
+ * half-angle theta_max, with sin(theta_max) = radius / distance. Directions are
+ * sampled uniformly inside that cone, so every sample hits the sphere and the
+ * solid-angle density is constant: 1 / (2 * pi * (1 - cos(theta_max))).
+ */
+struct SphereLight {
+    Point3 center;     // Center of the sphere
+    double radius;     // Radius of the sphere
+    MaterialId mat_id; // Emissive material of the sphere
+
+    /**
+     * @brief Samples a direction from p towards the sphere.
+     * @param u1, u2 Uniform random numbers in [0,1).
+     * @param wi Receives the sampled unit direction.
+     * @param distance Receives the distance from p to the sphere along wi.
+     * @param pdf Receives the solid-angle density of wi.
+     * @return false if p is inside the sphere (no cone to sample).
+     */
+    bool sample(const Point3& p, double u1, double u2, Vec3& wi, double& distance, double& pdf) const {
+        Vec3 to_center = center - p;
+        double dist2 = to_center.length_squared();
+        double radius2 = radius * radius;
+        if (dist2 <= radius2) return false;
+
+        // 1. Uniform direction inside the cone around the direction to the center
+        double dist = sqrt(dist2);
+        double sin2_max = radius2 / dist2;
+        double cos_max = sqrt(fmax(0.0, 1.0 - sin2_max));
+        double one_minus_cos_max = sin2_max / (1.0 + cos_max); // Accurate for small lights
+        double cos_theta = 1.0 - u1 * one_minus_cos_max;
+        double sin_theta = sqrt(fmax(0.0, 1.0 - cos_theta * cos_theta));
+        double phi = 2.0 * pi * u2;
+
+        Vec3 w = to_center / dist, a, b;
+        orthonormal_basis(w, a, b);
+        wi = (cos(phi) * sin_theta) * a + (sin(phi) * sin_theta) * b + cos_theta * w;
+
+        // 2. Distance to the near side of the sphere along wi
+        distance = dist * cos_theta - sqrt(fmax(0.0, radius2 - dist2 * sin_theta * sin_theta));
+        pdf = 1.0 / (2.0 * pi * one_minus_cos_max);
+        return true;
+    }
+
+    // Solid-angle density of sample() for any direction from p that hits the sphere
+    double pdf(const Point3& p) const {
+        double dist2 = (center - p).length_squared();
+        double radius2 = radius * radius;
+        if (dist2 <= radius2) return 0.0;
+        double sin2_max = radius2 / dist2;
+        double cos_max = sqrt(fmax(0.0, 1.0 - sin2_max));
+        return 1.0 / (2.0 * pi * sin2_max / (1.0 + cos_max));
+    }
+};
+
+
+/**
+ * @class LightList
+ * @brief The emissive spheres of a scene, sampled uniformly for direct lighting.
+ *
+ * Emissive objects that are not spheres are not sampled explicitly; they are
+ * still found (with full weight) by paths that hit them.
+ */
+class LightList {
+public:
+    std::vector<SphereLight> lights;
+
+    LightList() {}
+    explicit LightList(const Scene& scene) {
+        for (const auto& object : scene.objects) collect(object, scene.materials);
+    }
+
+    bool empty() const { return lights.empty(); }
+    size_t size() const { return lights.size(); }
+
+    /**
+     * @brief Finds the sampled light that a BSDF-sampled path has hit.
+     * @return The index of the light with material mat_id whose surface contains p, or -1.
+     */
+    int find(MaterialId mat_id, const Point3& p) const {
+        for (size_t i = 0; i < lights.size(); ++i) {
+            const SphereLight& light = lights[i];
+            if (light.mat_id == mat_id && fabs((p - light.center).length() - light.radius) <= 1e-3 * light.radius)
+                return static_cast<int>(i);
+        }
+        return -1;
+    }
+
+    // Solid-angle density of reaching light `index` from p, including the uniform light choice
+    double pdf(int index, const Point3& p) const {
+        return lights[index].pdf(p) / static_cast<double>(lights.size());
+    }
+
+private:
+    void collect(const shared_ptr<SceneBaseObject>& object, const MaterialTable& materials) {
+        if (auto group = std::dynamic_pointer_cast<Scene>(object)) {
+            for (const auto& child : group->objects) collect(child, materials);
+        } else if (auto sphere = std::dynamic_pointer_cast<Sphere>(object)) {
+            if (materials[sphere->mat_id].is_emissive())
+                lights.push_back({sphere->center, sphere->radius, sphere->mat_id});
+        }
+    }
+};
@@ -0,0 +1,38 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+/**
+ * @class MappedFile
+ * @brief Read-only view of a whole file, memory-mapped where the system allows it.
+ *
+ * On POSIX systems the file is mapped with mmap() and the kernel is told
+ * (madvise(MADV_SEQUENTIAL)) that it will be read once from start to end, so
+ * it reads ahead aggressively and may drop the pages already read. The file
+ * is never copied into the process: a parser reading view() in place keeps
+ * at most the file size resident, in the page cache. Elsewhere the file is
+ * read into a buffer owned by the object.
+ *
+ * The view is valid until the object is destroyed.
+ */
+class MappedFile {
+public:
+    /**
+     * @brief Maps the file.
+     * @throw std::runtime_error if the file cannot be opened or mapped.
+     */
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view view() const { return {data, length}; }
+    size_t size() const { return length; }
+
+private:
+    const char* data = nullptr;
+    size_t length = 0;
+    bool mapped = false; // data comes from mmap() and must be unmapped
+    std::string buffer;  // Contents of the file when it is not mapped
+};
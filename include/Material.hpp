@@ -1,47 +1,60 @@
 #pragma once
+#include <vector>
+#include <variant>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
 #include "Utils.hpp"
+#include "Sampler.hpp"
 #include "SceneBaseObject.hpp"
 
-// Forward Declaration
-struct HitRecord;
-
 /**
- * @class Material
- * @brief Abstract Base Class for all material types.
- * 
- * Defines the `scatter` function, which determines how a ray interacts
- * with a surface. It computes the bounced (scattered) ray and how much
- * the light is attenuated (reduced in color/intensity).
+ * @class MaterialBase
+ * @brief Default behaviour shared by all material types.
+ *
+ * The concrete materials (Matte, Metal, Glass, PointLight) derive from it and
+ * redefine the functions that differ. Nothing here is virtual: the material of
+ * a hit is dispatched once by Material (a closed set of types, see below), and
+ * every call inside the concrete type can be inlined.
  */
-class Material {
+class MaterialBase {
 public:
-    virtual ~Material() = default;
-
     /**
      * @brief Computes the amount of light emitted by the material at a specific point.
      * 
      * By default, materials are non-emissive and return black (0,0,0). 
-     * This function is overridden by light source materials (e.g., PointLight) 
+     * This function is redefined by light source materials (e.g., PointLight) 
      * to return their intrinsic color/intensity.
      * 
      * @param p The geometric point on the surface where the emission is calculated.
      * @return The color (radiance) of the light emitted.
      */
-    virtual Color emit(const Point3& p) const {
+    Color emit(const Point3& p) const {
         return Color(0,0,0);
     }
 
     /**
-     * @brief Computes the scattered ray after a hit.
-     * @param r_in The incoming ray.
-     * @param rec The HitRecord of the intersection.
-     * @param attenuate_color The color attenuation of the material.
-     * @param r_out The resulting scattered ray.
-     * @return true if the ray was scattered; false if it was absorbed.
+     * @brief Whether the material emits light (used to collect the scene's lights).
      */
-    virtual bool scatter(
-        const Ray& r_in, const HitRecord& rec, Color& attenuate_color, Ray& r_out
-    ) const = 0;
+    bool is_emissive() const { return false; }
+
+    /**
+     * @brief Whether the material is diffuse, i.e. can be lit by explicit light sampling.
+     * Specular materials (Metal, Glass) only receive light through their scattered ray.
+     */
+    bool is_diffuse() const { return false; }
+
+    /**
+     * @brief Evaluates BRDF * cos(theta) for the unit direction wi leaving the hit point.
+     * Only meaningful for diffuse materials.
+     */
+    Color eval(const HitRecord& rec, const Vec3& wi) const { return Color(0,0,0); }
+
+    /**
+     * @brief The probability density with which scatter() picks the unit direction wi.
+     * Only meaningful for diffuse materials.
+     */
+    double pdf(const HitRecord& rec, const Vec3& wi) const { return 0.0; }
 };
 
 
@@ -49,40 +62,51 @@ public:
  * @class Matte
  * @brief A diffuse (matte) material.
  * 
- * Light that hits a Matte surface scatters uniformly in a random direction.
+ * Light that hits a Matte surface scatters in a random direction, with a
+ * density proportional to the cosine with the normal (Lambert's law).
  * The color of the surface is determined by its albedo.
  */
-class Matte : public Material {
+class Matte : public MaterialBase {
 public:
     Color albedo; // The base color of the material
 
     Matte(const Color& a) : albedo(a) {}
 
-    virtual bool scatter(
-        const Ray& r_in, const HitRecord& rec, Color& attenuate_color, Ray& r_out
+    bool scatter(
+        const Ray& r_in, const HitRecord& rec, Color& attenuate_color, Ray& r_out, Sampler& sampler
     ) const {
-        // Calculate a random scatter direction
-        auto scatter_direction = rec.normal + random_unit_vector();
-
-        // Catch degenerate scatter direction
-        // If the random unit vector we generate is exactly opposite the normal, the sum will be zero.
-        if (scatter_direction.length_squared() < 1e-8)
-            scatter_direction = rec.normal;
-            
-        r_out = Ray(rec.p, scatter_direction);
+        // Calculate a random scatter direction (cosine-weighted around the normal)
+        double u1, u2;
+        sampler.get_2d(u1, u2);
+        r_out = Ray(rec.p, cosine_hemisphere(rec.normal, u1, u2));
         attenuate_color = albedo; // The ray's color is attenuated by the material's albedo
         return true; // A diffuse material always scatters
     }
 
+    bool is_diffuse() const { return true; }
+
+    // Lambertian BRDF (albedo / pi) times the cosine term
+    Color eval(const HitRecord& rec, const Vec3& wi) const {
+        return albedo * (fmax(dot(rec.normal, wi), 0.0) / pi);
+    }
+
+    // scatter() picks directions proportionally to cos(theta)
+    double pdf(const HitRecord& rec, const Vec3& wi) const {
+        return fmax(dot(rec.normal, wi), 0.0) / pi;
+    }
+
 private:
-    // Helper function to generate a random vector on the surface of a unit sphere
-    static Vec3 random_unit_vector() {
-        // Keep generating random points inside a cube until we find one inside the sphere
-        while (true) {
-            auto p = Vec3(random_double(-1,1), random_double(-1,1), random_double(-1,1));
-            if (p.length_squared() >= 1) continue; // If outside the sphere, try again
-            return unit_vector(p); // Normalize to get a point on the surface
-        }
+    /**
+     * @brief Maps (u1, u2) in [0,1)^2 to a unit direction with density cos(theta) / pi around n.
+     * Uniform point on the unit disk (r = sqrt(u1)) projected up onto the hemisphere (Malley's method):
+     * no rejection loop, always two random numbers.
+     */
+    static Vec3 cosine_hemisphere(const Vec3& n, double u1, double u2) {
+        double r = sqrt(u1);
+        float phi = static_cast<float>(2.0 * pi * u2); // Single precision trigonometry is plenty for a direction
+        Vec3 t, b;
+        orthonormal_basis(n, t, b);
+        return (r * std::cos(phi)) * t + (r * std::sin(phi)) * b + sqrt(std::max(0.0, 1.0 - u1)) * n;
     }
 };
 
@@ -94,21 +118,21 @@ private:
  * Simulates polished or fuzzy metal surfaces. The reflection can be perturbed
  * by a "fuzz" factor to create a blurred reflection effect.
  */
-class Metal : public Material {
+class Metal : public MaterialBase {
 public:
     Color albedo;  // The base color of the material
     double fuzz;   // fuzz effect (0~1)
 
     Metal(const Color& a, double f) : albedo(a), fuzz(f < 1 ? f : 1) {}
 
-    virtual bool scatter(
-        const Ray& r_in, const HitRecord& rec, Color& attenuate_color, Ray& r_out
+    bool scatter(
+        const Ray& r_in, const HitRecord& rec, Color& attenuate_color, Ray& r_out, Sampler& sampler
     ) const {
         // 1. Calculate the reflection vector
         Vec3 reflected = reflect(unit_vector(r_in.direction()), rec.normal);
         
         // 2. Add a blur effect
-        r_out = Ray(rec.p, reflected + fuzz * random_in_unit_sphere());
+        r_out = Ray(rec.p, reflected + fuzz * random_in_unit_sphere(sampler));
         
         attenuate_color = albedo;
         
@@ -118,12 +142,32 @@ public:
     }
 
 private:
-    static Vec3 random_in_unit_sphere() {
-        while (true) {
-            auto p = Vec3(random_double(-1,1), random_double(-1,1), random_double(-1,1));
-            if (p.length_squared() >= 1) continue;
-            return p;
-        }
+    /**
+     * @brief Uniform point in the unit ball, from exactly three random numbers.
+     * A uniform direction (z = 1 - 2 u1, azimuth 2 pi u2) scaled by the radius cbrt(u3).
+     */
+    static Vec3 random_in_unit_sphere(Sampler& sampler) {
+        double u1, u2;
+        sampler.get_2d(u1, u2);
+        double radius = cube_root(static_cast<float>(sampler.get_1d()));
+        double z = 1.0 - 2.0 * u1;
+        double r = sqrt(std::max(0.0, 1.0 - z * z));
+        float phi = static_cast<float>(2.0 * pi * u2);
+        return radius * Vec3(r * std::cos(phi), r * std::sin(phi), z);
+    }
+
+    // Cube root of x in [0, 1): exponent-thirding initial guess and two Newton steps
+    // (relative error below 2e-6, about three times faster than std::cbrt)
+    static float cube_root(float x) {
+        if (x <= 0.0f) return 0.0f;
+        uint32_t bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        bits = bits / 3 + 709921077u;
+        float y;
+        std::memcpy(&y, &bits, sizeof(y));
+        y -= (y * y * y - x) / (3.0f * y * y);
+        y -= (y * y * y - x) / (3.0f * y * y);
+        return y;
     }
 };
 
@@ -136,14 +180,14 @@ private:
  * for reflectance to decide whether a ray refracts or reflects. It also handles
  * total internal reflection.
  */
-class Glass : public Material {
+class Glass : public MaterialBase {
 public:
     double ir; // Index of refraction of glass 
 
     Glass(double index_of_refraction) : ir(index_of_refraction) {}
 
-    virtual bool scatter(
-        const Ray& r_in, const HitRecord& rec, Color& attenuate_color, Ray& r_out
+    bool scatter(
+        const Ray& r_in, const HitRecord& rec, Color& attenuate_color, Ray& r_out, Sampler& sampler
     ) const {
         attenuate_color = Color(1.0, 1.0, 1.0); // Glass does not absorb color
         double refraction_ratio = rec.front_face ? (1.0/ir) : ir;
@@ -158,7 +202,7 @@ public:
         Vec3 direction;
 
         // Schlick approximation of reflection probability
-        if (cannot_refract || reflectance(cos_theta, refraction_ratio) > random_double()) {
+        if (cannot_refract || reflectance(cos_theta, refraction_ratio) > sampler.get_1d()) {
             // Total internal reflection
             direction = reflect(unit_direction, rec.normal);
         } else {
@@ -187,21 +231,125 @@ private:
  * Unlike other materials, it does NOT scatter rays (it absorbs them or passes them through).
  * Instead, it adds light energy to the ray path.
  */
-class PointLight : public Material {
+class PointLight : public MaterialBase {
 public:
     Color emit_color;
 
     PointLight(Color c) : emit_color(c) {}
 
     // Scattering: The simplified light source does not reflect light.
-    virtual bool scatter(
-        const Ray& r_in, const HitRecord& rec, Color& attenuation, Ray& scattered
+    bool scatter(
+        const Ray& r_in, const HitRecord& rec, Color& attenuation, Ray& scattered, Sampler& sampler
     ) const {
         return false;
     }
 
     // Emission: Returns the color of the light source
-    virtual Color emit(const Point3& p) const {
+    Color emit(const Point3& p) const {
         return emit_color;
     }
-};
\ No newline at end of file
+
+    bool is_emissive() const { return true; }
+};
+
+
+/**
+ * @class Material
+ * @brief A material of any of the supported types (a closed tagged union).
+ *
+ * The set of material types is fixed (those of the XML scene format), so a
+ * material is stored by value in a std::variant rather than behind a virtual
+ * base class. Each call dispatches on the type tag and then runs the concrete
+ * type's function, which the compiler can inline into the integrator; there is
+ * no pointer to chase and the materials of a scene lie contiguously in memory.
+ *
+ * Adding a material type means adding it to Material::Variant.
+ */
+class Material {
+public:
+    using Variant = std::variant<Matte, Metal, Glass, PointLight>;
+    static constexpr size_t type_count = std::variant_size_v<Variant>;
+
+    template <typename T>
+    explicit Material(T material) : data(std::move(material)) {}
+
+    /**
+     * @brief Computes the amount of light emitted by the material at a specific point.
+     */
+    Color emit(const Point3& p) const {
+        return std::visit([&](const auto& m) { return m.emit(p); }, data);
+    }
+
+    /**
+     * @brief Computes the scattered ray after a hit.
+     * @param r_in The incoming ray.
+     * @param rec The HitRecord of the intersection.
+     * @param attenuate_color The color attenuation of the material.
+     * @param r_out The resulting scattered ray.
+     * @param sampler The sampler providing the random numbers of this bounce.
+     * @return true if the ray was scattered; false if it was absorbed.
+     */
+    bool scatter(
+        const Ray& r_in, const HitRecord& rec, Color& attenuate_color, Ray& r_out, Sampler& sampler
+    ) const {
+        return std::visit([&](const auto& m) { return m.scatter(r_in, rec, attenuate_color, r_out, sampler); }, data);
+    }
+
+    bool is_emissive() const {
+        return std::visit([](const auto& m) { return m.is_emissive(); }, data);
+    }
+
+    bool is_diffuse() const {
+        return std::visit([](const auto& m) { return m.is_diffuse(); }, data);
+    }
+
+    Color eval(const HitRecord& rec, const Vec3& wi) const {
+        return std::visit([&](const auto& m) { return m.eval(rec, wi); }, data);
+    }
+
+    double pdf(const HitRecord& rec, const Vec3& wi) const {
+        return std::visit([&](const auto& m) { return m.pdf(rec, wi); }, data);
+    }
+
+    // Index of the material's type in the variant, in [0, type_count)
+    size_t type_index() const { return data.index(); }
+
+    // Calls f with the concrete material (e.g. to serialise its parameters)
+    template <typename F>
+    decltype(auto) visit(F&& f) const { return std::visit(std::forward<F>(f), data); }
+
+private:
+    Variant data;
+};
+
+
+/**
+ * @class MaterialTable
+ * @brief Scene-owned storage of all materials, addressed by a 32-bit MaterialId.
+ *
+ * Primitives and HitRecords only carry the MaterialId. The integrator looks the
+ * material up through a plain reference, so the hot path never copies a
+ * shared_ptr (whose atomic reference count would be contended by all threads).
+ * The materials are stored by value, one after the other.
+ */
+class MaterialTable {
+public:
+    /**
+     * @brief Creates a material of type T in the table.
+     * @param args The arguments forwarded to the constructor of T.
+     * @return The id of the new material.
+     */
+    template <typename T, typename... Args>
+    MaterialId add(Args&&... args) {
+        materials.emplace_back(T(std::forward<Args>(args)...));
+        return static_cast<MaterialId>(materials.size() - 1);
+    }
+
+    const Material& operator[](MaterialId id) const { return materials[id]; }
+
+    size_t size() const { return materials.size(); }
+    void clear() { materials.clear(); }
+
+private:
+    std::vector<Material> materials;
+};
@@ -12,10 +12,10 @@ class Sphere : public SceneBaseObject {
 public:
     Point3 center;                // Center coordinate of the sphere
     double radius;                // Radius of the sphere
-    shared_ptr<Material> mat_ptr; // Material of the sphere
+    MaterialId mat_id = 0;        // Material of the sphere
 
     Sphere() {}
-    Sphere(Point3 cen, double r, shared_ptr<Material> m) : center(cen), radius(r), mat_ptr(m) {}
+    Sphere(Point3 cen, double r, MaterialId m) : center(cen), radius(r), mat_id(m) {}
     ~Sphere() = default;
 
     /**
@@ -50,10 +50,33 @@ public:
         // Calculate outward normal: (Point - Center) / Radius
         Vec3 outward_normal = (rec.p - center) / radius;
         rec.set_face_normal(r, outward_normal);
-        rec.mat_ptr = mat_ptr;
+        rec.mat_id = mat_id;
 
         return true;
     }
+
+    // Same roots as hit(), without building the HitRecord
+    virtual bool occluded(const Ray& r, double t_min, double t_max) const override {
+        Vec3 oc = r.origin() - center;
+        auto a = r.direction().length_squared();
+        auto half_b = dot(oc, r.direction());
+        auto c = oc.length_squared() - radius*radius;
+
+        auto discriminant = half_b*half_b - a*c;
+        if (discriminant < 0) return false;
+
+        auto sqrtd = sqrt(discriminant);
+        auto root = (-half_b - sqrtd) / a;
+        if (root >= t_min && root <= t_max) return true;
+        root = (-half_b + sqrtd) / a;
+        return root >= t_min && root <= t_max;
+    }
+
+    virtual bool bounding_box(AABB& output_box) const override {
+        Vec3 r_vec(radius, radius, radius);
+        output_box = AABB(center - r_vec, center + r_vec);
+        return true;
+    }
 };
 
 
@@ -71,11 +94,11 @@ class Plane : public SceneBaseObject {
 public:
     Point3 point; // A fix point on the plane
     Vec3 normal;  // A normal of the plane
-    shared_ptr<Material> mat_ptr; // The material of the plane
+    MaterialId mat_id = 0;        // The material of the plane
 
     Plane() {}
-    Plane(Point3 p, Vec3 n, shared_ptr<Material> m) 
-        : point(p), normal(unit_vector(n)), mat_ptr(m) {}
+    Plane(Point3 p, Vec3 n, MaterialId m) 
+        : point(p), normal(unit_vector(n)), mat_id(m) {}
 
     virtual bool hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const override {
         // Denominator: Dot product of ray direction and plane normal
@@ -97,10 +120,23 @@ public:
         
         // Determine whether the light hits the front or the back of the plane.
         rec.set_face_normal(r, normal);
-        rec.mat_ptr = mat_ptr;
+        rec.mat_id = mat_id;
 
         return true;
     }
+
+    virtual bool occluded(const Ray& r, double t_min, double t_max) const override {
+        auto denom = dot(r.direction(), normal);
+        if (std::abs(denom) < 1e-6) return false;
+
+        auto t = dot(point - r.origin(), normal) / denom;
+        return t >= t_min && t <= t_max;
+    }
+
+    // An infinite plane has no finite bounding box: it is kept outside the BVH.
+    virtual bool bounding_box(AABB& output_box) const override {
+        return false;
+    }
 };
 
 
@@ -119,15 +155,15 @@ class Parallelogram : public SceneBaseObject {
 public:
     Point3 Q; // A vertex
     Vec3 u, v; // The edge vectors
-    shared_ptr<Material> mat_ptr;
+    MaterialId mat_id = 0;
     
     // Pre-computed constants to optimize ray tracing computation performance.
     Vec3 normal;
     double D;
     Vec3 w; 
 
-    Parallelogram(const Point3& _Q, const Vec3& _u, const Vec3& _v, shared_ptr<Material> m)
-        : Q(_Q), u(_u), v(_v), mat_ptr(m)
+    Parallelogram(const Point3& _Q, const Vec3& _u, const Vec3& _v, MaterialId m)
+        : Q(_Q), u(_u), v(_v), mat_id(m)
     {
         // 1. Calculate the normal: n = u x v
         auto n = cross(u, v);
@@ -165,9 +201,32 @@ public:
         // 5. Hit! Record data
         rec.t = t;
         rec.p = intersection;
-        rec.mat_ptr = mat_ptr;
+        rec.mat_id = mat_id;
         rec.set_face_normal(r, normal);
 
         return true;
     }
+
+    virtual bool occluded(const Ray& r, double t_min, double t_max) const override {
+        auto denom = dot(normal, r.direction());
+        if (std::abs(denom) < 1e-8) return false;
+
+        auto t = (D - dot(normal, r.origin())) / denom;
+        if (t < t_min || t > t_max) return false;
+
+        Vec3 planar_hitpt_vector = r.at(t) - Q;
+        auto alpha = dot(w, cross(planar_hitpt_vector, v));
+        auto beta = dot(w, cross(u, planar_hitpt_vector));
+        return alpha >= 0 && alpha <= 1 && beta >= 0 && beta <= 1;
+    }
+
+    virtual bool bounding_box(AABB& output_box) const override {
+        // Box of the four vertices, padded since an axis-aligned face is flat
+        output_box = AABB(Q, Q);
+        output_box.expand(Q + u);
+        output_box.expand(Q + v);
+        output_box.expand(Q + u + v);
+        output_box.pad();
+        return true;
+    }
 };
\ No newline at end of file
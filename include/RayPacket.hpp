@@ -0,0 +1,80 @@
+#pragma once
+#include <cmath>
+#include <algorithm>
+#include "Utils.hpp"
+
+/**
+ * @struct RayPacket
+ * @brief Up to 64 rays sharing one origin, traced through the scene together.
+ *
+ * The camera rays of a block of neighbouring pixels (8x8) start at the camera
+ * and have nearly the same direction, so they visit almost the same nodes of
+ * the BVH. Traversing the tree once for the whole packet amortises the node
+ * fetches, and a box can often be rejected for all rays at once.
+ *
+ * That shared rejection uses interval arithmetic: once `finish()` has been
+ * called, the packet knows, per axis, the range [inv_min, inv_max] of the
+ * inverse directions of its rays. If all the rays go the same way along an
+ * axis, the entry and exit distances of every ray into a slab lie within
+ * bounds computed from that range; when the largest possible entry is past
+ * the smallest possible exit, no ray of the packet can hit the box.
+ */
+struct RayPacket {
+    static constexpr int max_size = 64;
+
+    int size = 0;
+    Point3 origin;             // Common origin of the rays
+    Vec3 direction[max_size];  // Direction of each ray
+    Vec3 inv_dir[max_size];    // Component-wise inverse of each direction
+
+    // Range of the inverse directions over the packet, per axis
+    double inv_min[3];
+    double inv_max[3];
+    bool same_sign[3];         // All the rays go the same way along the axis (finite inverses)
+
+    // Empties the packet; the rays added next start at `o`
+    void reset(const Point3& o) {
+        origin = o;
+        size = 0;
+    }
+
+    void add(const Vec3& d) {
+        direction[size] = d;
+        inv_dir[size] = Vec3(1.0 / d[0], 1.0 / d[1], 1.0 / d[2]);
+        ++size;
+    }
+
+    Ray ray(int k) const { return Ray(origin, direction[k]); }
+
+    // Computes the ranges of the inverse directions, once all the rays are added
+    void finish() {
+        for (int a = 0; a < 3; ++a) {
+            inv_min[a] = infinity;
+            inv_max[a] = -infinity;
+            for (int k = 0; k < size; ++k) {
+                inv_min[a] = std::min(inv_min[a], inv_dir[k][a]);
+                inv_max[a] = std::max(inv_max[a], inv_dir[k][a]);
+            }
+            same_sign[a] = std::isfinite(inv_min[a]) && std::isfinite(inv_max[a]) &&
+                           (inv_min[a] > 0.0 || inv_max[a] < 0.0);
+        }
+    }
+
+    /**
+     * @brief Conservative box test for the whole packet.
+     * @param t_max The largest t_max of the rays still searching for a closer hit.
+     * @return false only if no ray of the packet crosses the box within [t_min, t_max].
+     */
+    bool may_hit(const float bounds_min[3], const float bounds_max[3], double t_min, double t_max) const {
+        for (int a = 0; a < 3; ++a) {
+            if (!same_sign[a]) continue; // No bound along this axis
+            bool negative = inv_max[a] < 0.0;
+            double near_plane = (negative ? bounds_max[a] : bounds_min[a]) - origin[a];
+            double far_plane = (negative ? bounds_min[a] : bounds_max[a]) - origin[a];
+            t_min = std::max(t_min, std::min(near_plane * inv_min[a], near_plane * inv_max[a]));
+            t_max = std::min(t_max, std::max(far_plane * inv_min[a], far_plane * inv_max[a]));
+            if (t_max < t_min) return false;
+        }
+        return true;
+    }
+};
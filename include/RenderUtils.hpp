@@ -4,91 +4,195 @@
 #include <vector>
 #include <atomic>
 #include <cmath>
+#include <functional>
 #include "Object.hpp"
 #include "Scene.hpp"
+#include "Light.hpp"
+#include "Film.hpp"
+#include "Sampler.hpp"
+#include "Integrator.hpp"
+#include "TileScheduler.hpp"
 #include "SceneXMLParser.hpp"
 
-// Pixel structure
-struct Pixel { int r, g, b; };
-
 // Container for camera settings to avoid global variables
 struct CameraConfig {
+    Point3 origin = Point3(0, 0, 0);
+    float focal_length = 1.0f;
+    float viewport_height = 2.0f;
+    float aspect_ratio = 16.0f / 9.0f;
+};
+
+// The viewport of the camera for an image of a given width
+struct Viewport {
     Point3 origin;
-    float focal_length;
-    float viewport_height;
-    float aspect_ratio;
+    Vec3 horizontal;
+    Vec3 vertical;
+    Point3 lower_left_corner;
+    int image_height; // Follows from the width and the camera's aspect ratio
 };
 
 /**
- * @brief Calculate the color that a specific ray of light will eventually see.
+ * @brief Places the viewport of the camera for an image `image_width` pixels wide.
+ */
+inline Viewport make_viewport(const CameraConfig& cam_config, int image_width) {
+    Viewport view;
+    float viewport_width = cam_config.aspect_ratio * cam_config.viewport_height;
+    view.image_height = static_cast<int>(image_width / cam_config.aspect_ratio);
+    view.origin = cam_config.origin;
+    view.horizontal = Vec3(viewport_width, 0, 0);
+    view.vertical = Vec3(0, cam_config.viewport_height, 0);
+    view.lower_left_corner = view.origin - view.horizontal/2 - view.vertical/2 - Vec3(0, 0, cam_config.focal_length);
+    return view;
+}
+
+// Called with (tile, completed tiles, total tiles) by the thread that just finished the tile
+using ProgressCallback = std::function<void(const Tile&, int, int)>;
+
+/**
+ * @brief Calculate the final color seen by a specific ray (iterative path tracer).
+ *
+ * After `rr_min_depth` bounces, Russian roulette terminates the path with a
+ * probability that grows as the path throughput gets darker. At every diffuse
+ * hit the emissive spheres are sampled explicitly and combined with BSDF
+ * sampling by multiple importance sampling.
+ *
  * @param r The ray.
- * @param world The scene.
- * @param depth Maximum number of ray bounces.
+ * @param world The scene (or its acceleration structure).
+ * @param materials The material table the hit records refer to.
+ * @param lights The emissive spheres sampled for direct lighting.
  * @param bg_color The background color if the ray hits nothing.
+ * @param max_depth Maximum number of ray bounces.
+ * @param rr_min_depth Number of bounces before Russian roulette may terminate the path.
+ * @param sampler The sampler of the current pixel sample (start_pixel_sample() already called).
  * @return The final color of the pixel.
  */
-Color ray_color(const Ray& r, const SceneBaseObject& world, int depth, const Color& bg_color);
+Color ray_color(const Ray& r, const SceneBaseObject& world, const MaterialTable& materials,
+                const LightList& lights, const Color& bg_color, int max_depth, int rr_min_depth,
+                Sampler& sampler);
+
+/**
+ * @brief ray_color for a ray whose first intersection is already known (e.g. traced in a RayPacket).
+ * @param first_hit Whether r hits the scene.
+ * @param first_rec The hit of r, if first_hit.
+ * The other parameters are those of ray_color above.
+ */
+Color ray_color(const Ray& r, bool first_hit, const HitRecord& first_rec,
+                const SceneBaseObject& world, const MaterialTable& materials,
+                const LightList& lights, const Color& bg_color, int max_depth, int rr_min_depth,
+                Sampler& sampler);
 
 /**
  * @brief Converts parsed XML data into actual renderable scene objects and configuration.
- * 
- * This function acts as a factory that iterates through the raw data structure (SceneData), 
- * instantiates specific materials (Matte, Metal, Glass) and geometric primitives 
- * (Sphere, Plane, Parallelepiped), and adds them to the rendering scene. 
- * It also configures global camera parameters and background settings based on the input.
- * 
- * @param data The raw data structure containing string-based properties parsed from XML.
+ *
+ * This function acts as a factory that iterates through the parsed data structure (SceneData),
+ * instantiates specific materials (Matte, Metal, Glass) and geometric primitives
+ * (Sphere, Plane, Parallelepiped), and adds them to the rendering scene.
+ * It also configures the camera parameters and background settings based on the input.
+ * The values are already typed and checked by the parser, so this is a single pass
+ * that only copies them.
+ *
+ * @param data The typed scene description parsed from XML.
  * @param render_scene The destination scene object where created objects will be added.
  * @param cam_config Reference to a CameraConfig struct to be populated with camera parameters.
  * @param bg_color Reference to a Color object to be updated with the scene's background color.
  */
 void convertSceneDataToRenderScene(
-    const SceneData& data, 
-    Scene& render_scene, 
-    CameraConfig& cam_config, 
+    const SceneData& data,
+    Scene& render_scene,
+    CameraConfig& cam_config,
     Color& bg_color
 );
 
 /**
- * @brief Renders a portion of the scene using a block-based round-robin scheduling strategy.
+ * @brief Renders tiles of the image for one thread, until the scheduler runs out of tiles.
+ *
+ * This function is designed to be run by multiple threads in parallel, all sharing
+ * one TileScheduler. The tiles were dealt round-robin between the threads (thread 0
+ * takes tile 0, N, 2N... of the Morton order), so complex areas of the image are
+ * distributed among all threads; a thread that finishes its share steals the
+ * remaining tiles of the others.
  *
- * This function is designed to be run by multiple threads in parallel. Instead of assigning
- * a single contiguous chunk of rows to each thread, it divides the image into small blocks
- * and assigns them in an interleaved pattern (e.g., Thread 0 takes block 0, N, 2N...).
- * This ensures better load balancing, as complex areas of the image are distributed among all threads.
+ * For each pixel, it traces `samples_per_pixel` jittered rays (anti-aliasing) and adds
+ * them to the shared film without mutexes (since tiles are disjoint). The camera rays of
+ * the same sample in an 8x8 block of pixels are intersected together as a RayPacket;
+ * the rest of each path is traced ray by ray. Calling it again
+ * over the same film adds more samples (progressive rendering); gamma correction is
+ * applied when the film is resolved. The render time of every tile is recorded in the scheduler.
  *
- * For each pixel, it performs anti-aliasing (multi-sampling), gamma correction,
- * and writes the final RGB values directly into the shared pixel buffer without mutexes
- * (since write areas are disjoint).
+ * With adaptive sampling, pixels the film reports as converged are skipped and no
+ * pixel goes past `adaptive->max_samples`, so a pass only spends time on noisy pixels.
  *
  * @param thread_id The unique ID of the current thread (0 to num_threads-1).
- * @param num_threads The total number of threads utilized.
- * @param block_size The number of scanlines per block (e.g., 32) for cache efficiency.
- * @param render_scene The scene object containing all geometry and lights.
+ * @param scheduler The tile scheduler shared by all threads.
+ * @param world The scene (or its acceleration structure).
+ * @param materials The material table of the scene.
+ * @param lights The emissive spheres sampled for direct lighting.
  * @param origin The camera origin.
  * @param horizontal The horizontal viewport vector.
  * @param vertical The vertical viewport vector.
  * @param lower_left_corner The lower-left corner of the viewport.
  * @param image_width Width of the image in pixels.
  * @param image_height Height of the image in pixels.
- * @param samples_per_pixel Number of random samples per pixel for anti-aliasing.
- * @param max_depth Maximum recursion depth for ray bouncing.
+ * @param samples_per_pixel Number of random samples per pixel to add in this pass.
+ * @param max_depth Maximum number of ray bounces.
+ * @param rr_min_depth Number of bounces before Russian roulette may terminate a path.
  * @param bg_color The environmental background color used when a ray hits nothing.
- * @param pixel_buffer The output buffer where calculated pixel colors are stored.
- * @param completed_lines Atomic counter used to track and display global progress.
+ * @param film The floating-point image the samples are accumulated into.
+ * @param completed_tiles Atomic counter used to track global progress.
+ * @param progress Called after each finished tile, from the rendering thread (must be thread-safe).
+ * @param cancel When set (by another thread), the render stops at the next 8x8 block of pixels
+ *               (the wavefront engine: at the next bounce of its batch).
+ * @param adaptive Stopping rule of adaptive sampling, or nullptr to sample every pixel.
+ * @param sampler The sample generator, cloned by each thread (nullptr: independent random numbers).
  */
 void render_blocks_round_robin(
     int thread_id,
+    TileScheduler& scheduler,
+    const SceneBaseObject& world,
+    const MaterialTable& materials,
+    const LightList& lights,
+    const Point3& origin, const Vec3& horizontal, const Vec3& vertical,
+    const Point3& lower_left_corner,
+    int image_width, int image_height,
+    int samples_per_pixel, int max_depth, int rr_min_depth,
+    const Color& bg_color,
+    Film& film,
+    std::atomic<int>& completed_tiles,
+    const ProgressCallback& progress = nullptr,
+    const std::atomic<bool>* cancel = nullptr,
+    const AdaptiveSampling* adaptive = nullptr,
+    const Sampler* sampler = nullptr
+);
+
+/**
+ * @brief Renders the whole image with `num_threads` threads running render_blocks_round_robin.
+ *
+ * Uses an OpenMP parallel region when the program is built with OpenMP, and
+ * std::threads otherwise. In both cases the calling thread is thread 0 and
+ * returns once every tile is done or the render was cancelled. It should not
+ * be the GUI thread: progress is reported through the callback instead.
+ * Parameters are those of render_blocks_round_robin, plus:
+ *
+ * @param engine Megakernel (render_blocks_round_robin) or Wavefront (render_blocks_wavefront).
+ */
+void render_tiles(
     int num_threads,
-    int block_size,
-    const Scene& render_scene,
+    TileScheduler& scheduler,
+    const SceneBaseObject& world,
+    const MaterialTable& materials,
+    const LightList& lights,
     const Point3& origin, const Vec3& horizontal, const Vec3& vertical,
     const Point3& lower_left_corner,
     int image_width, int image_height,
-    int samples_per_pixel, int max_depth,
+    int samples_per_pixel, int max_depth, int rr_min_depth,
     const Color& bg_color,
-    std::vector<Pixel>& pixel_buffer,
-    std::atomic<int>& completed_lines
+    Film& film,
+    std::atomic<int>& completed_tiles,
+    const ProgressCallback& progress = nullptr,
+    const std::atomic<bool>* cancel = nullptr,
+    const AdaptiveSampling* adaptive = nullptr,
+    const Sampler* sampler = nullptr,
+    RenderEngine engine = RenderEngine::Megakernel
 );
 
-#endif // RENDER_UTILS_HPP
\ No newline at end of file
+#endif // RENDER_UTILS_HPP
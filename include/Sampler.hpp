@@ -0,0 +1,327 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+#include "Utils.hpp"
+
+/**
+ * @brief The available sample generators.
+ */
+enum class SamplerType {
+    Independent, // Uncorrelated random numbers
+    Stratified,  // One jittered stratum per sample in every dimension (Latin hypercube)
+    Sobol,       // Owen-scrambled Sobol sequence, padded by shuffling
+    BlueNoise    // Rank-1 Kronecker sequence shifted by a blue-noise dither mask
+};
+
+
+/**
+ * @class Sampler
+ * @brief Generates the random numbers of one pixel sample, dimension by dimension.
+ *
+ * The integrator calls start_pixel_sample() before tracing a sample, then reserves
+ * a block of dimensions for each use (camera jitter, one block per bounce) with
+ * start_dimensions(), and reads them in order with get_1d()/get_2d(). Consuming the
+ * same dimension for the same purpose in every sample is what lets the better
+ * generators spread the samples of a pixel evenly.
+ *
+ * Values requested beyond the reserved block (e.g. by a rejection sampling loop)
+ * are independent random numbers, so the estimate stays correct; only their
+ * distribution is not improved.
+ *
+ * A sampler is used by one thread; render threads each get a clone().
+ */
+class Sampler {
+public:
+    virtual ~Sampler() = default;
+
+    // A new sampler of the same type and settings, for another thread
+    virtual std::unique_ptr<Sampler> clone() const = 0;
+
+    // Starts sample `sample_index` of pixel (i, j); the block [0, 2) is reserved for the camera
+    void start_pixel_sample(int i, int j, int sample_index) {
+        px = i;
+        py = j;
+        pixel_key = mix64((static_cast<uint64_t>(j) << 32) | static_cast<uint32_t>(i));
+        index = static_cast<uint32_t>(sample_index);
+        start_sample(pixel_key, index); // Stream of the values outside the reserved blocks
+        start_dimensions(0, 2);
+    }
+
+    // Reserves dimensions [first, first + count) for the next get_1d() / get_2d() calls
+    void start_dimensions(int first, int count) {
+        dimension = first;
+        dimension_end = first + count;
+    }
+
+    double get_1d() {
+        if (dimension < dimension_end) return sample(dimension++);
+        return random_double();
+    }
+
+    void get_2d(double& u, double& v) {
+        u = get_1d();
+        v = get_1d();
+    }
+
+protected:
+    // Value of the current sample in one dimension, in [0, 1)
+    virtual double sample(int dim) const = 0;
+
+    // A 32-bit hash of the current pixel, a dimension, what the value is used for and an extra key
+    uint32_t hash(int dim, uint32_t purpose, uint64_t extra = 0) const {
+        uint64_t key = mix64(pixel_key + ((static_cast<uint64_t>(dim) << 8) | purpose) * 0x9E3779B97F4A7C15ull);
+        return static_cast<uint32_t>(mix64(key + extra * 0xD1B54A32D192ED03ull));
+    }
+
+    static double to_unit(uint32_t bits) { return bits * 0x1.0p-32; }
+
+    int px = 0, py = 0;      // Current pixel
+    uint64_t pixel_key = 0;  // Hash of the current pixel
+    uint32_t index = 0;      // Index of the current sample in the pixel
+
+private:
+    int dimension = 0;       // Next dimension of the reserved block
+    int dimension_end = 0;   // End of the reserved block
+};
+
+
+/**
+ * @class IndependentSampler
+ * @brief Every dimension of every sample is an independent uniform random number.
+ */
+class IndependentSampler : public Sampler {
+public:
+    std::unique_ptr<Sampler> clone() const override { return std::make_unique<IndependentSampler>(*this); }
+
+protected:
+    double sample(int dim) const override { return to_unit(hash(dim, 0, index)); }
+};
+
+
+/**
+ * @class StratifiedSampler
+ * @brief Each dimension is split into `samples_per_pixel` strata, one jittered sample per stratum.
+ *
+ * The strata are visited in a random order that is a different permutation
+ * for every pixel and dimension (Latin hypercube sampling), so any prefix of
+ * the samples is still an unbiased random subset. Past `samples_per_pixel`
+ * samples (adaptive sampling), a new permutation starts.
+ */
+class StratifiedSampler : public Sampler {
+public:
+    explicit StratifiedSampler(int samples_per_pixel) : strata(std::max(1, samples_per_pixel)) {}
+
+    std::unique_ptr<Sampler> clone() const override { return std::make_unique<StratifiedSampler>(*this); }
+
+protected:
+    double sample(int dim) const override {
+        uint32_t round = index / strata;
+        uint32_t stratum = permute(index % strata, strata, hash(dim, 1, round));
+        return (stratum + to_unit(hash(dim, 0, index))) / strata;
+    }
+
+private:
+    // Random permutation of [0, l) indexed by p, evaluated at i without storing it (Kensler 2013)
+    static uint32_t permute(uint32_t i, uint32_t l, uint32_t p) {
+        uint32_t w = l - 1;
+        w |= w >> 1; w |= w >> 2; w |= w >> 4; w |= w >> 8; w |= w >> 16;
+        do {
+            i ^= p;             i *= 0xe170893d;
+            i ^= p >> 16;       i ^= (i & w) >> 4;
+            i ^= p >> 8;        i *= 0x0929eb3f;
+            i ^= p >> 23;       i ^= (i & w) >> 1;
+            i *= 1 | p >> 27;   i *= 0x6935fa69;
+            i ^= (i & w) >> 11; i *= 0x74dcb303;
+            i ^= (i & w) >> 2;  i *= 0x9e501cc3;
+            i ^= (i & w) >> 2;  i *= 0xc860a3df;
+            i &= w;             i ^= i >> 5;
+        } while (i >= l);
+        return (i + p) % l;
+    }
+
+    uint32_t strata; // Number of strata per dimension
+};
+
+
+/**
+ * @class SobolSampler
+ * @brief Owen-scrambled Sobol points (Burley, "Practical Hash-based Owen Scrambling", 2020).
+ *
+ * Dimensions are taken in groups of four, each group being the first four
+ * Sobol dimensions: every prefix of 2^k samples is well stratified in each
+ * group, in particular in the 2D pairs (camera jitter, light position). The
+ * groups are decorrelated by shuffling the sample index with a per-pixel,
+ * per-group nested uniform scramble, and every value is Owen-scrambled per
+ * pixel and dimension, which keeps the points randomised and unbiased.
+ */
+class SobolSampler : public Sampler {
+public:
+    std::unique_ptr<Sampler> clone() const override { return std::make_unique<SobolSampler>(*this); }
+
+protected:
+    double sample(int dim) const override {
+        // The shuffled index is shared by the four dimensions of a group
+        if (dim / 4 != shuffled_group || index != shuffled_for || pixel_key != shuffled_pixel) {
+            shuffled_group = dim / 4;
+            shuffled_for = index;
+            shuffled_pixel = pixel_key;
+            shuffled_index = nested_uniform_scramble(index, hash(dim / 4, 2));
+        }
+        uint32_t bits = sobol(shuffled_index, dim % 4);
+        return to_unit(nested_uniform_scramble(bits, hash(dim, 3)));
+    }
+
+private:
+    // Sobol point `i` in one of the first four dimensions (direction numbers of Joe & Kuo)
+    static uint32_t sobol(uint32_t i, int dim) {
+        if (dim == 0) return reverse_bits(i); // van der Corput
+        // XOR of the direction numbers of the set bits of i, one byte of i at a time
+        const auto& t = directions().bytes[dim];
+        return t[0][i & 0xFF] ^ t[1][(i >> 8) & 0xFF] ^ t[2][(i >> 16) & 0xFF] ^ t[3][i >> 24];
+    }
+
+    struct DirectionNumbers {
+        uint32_t v[4][32];
+        uint32_t bytes[4][4][256]; // bytes[d][k][b]: XOR of v[d][8k + j] for the set bits j of b
+        DirectionNumbers() {
+            // Dimension 0 is the van der Corput sequence; then x + 1, x^2 + x + 1, x^3 + x + 1
+            const int degree[4] = {0, 1, 2, 3};
+            const uint32_t coeffs[4] = {0, 0, 1, 1};
+            const uint32_t initial[4][3] = {{0, 0, 0}, {1, 0, 0}, {1, 3, 0}, {1, 3, 1}};
+            for (int k = 0; k < 32; ++k) v[0][k] = 1u << (31 - k);
+            for (int d = 1; d < 4; ++d) {
+                int s = degree[d];
+                for (int k = 0; k < 32; ++k) {
+                    if (k < s) {
+                        v[d][k] = initial[d][k] << (31 - k);
+                        continue;
+                    }
+                    v[d][k] = v[d][k - s] ^ (v[d][k - s] >> s);
+                    for (int j = 1; j < s; ++j)
+                        if ((coeffs[d] >> (s - 1 - j)) & 1) v[d][k] ^= v[d][k - j];
+                }
+            }
+            for (int d = 0; d < 4; ++d)
+                for (int k = 0; k < 4; ++k)
+                    for (int b = 0; b < 256; ++b) {
+                        bytes[d][k][b] = 0;
+                        for (int j = 0; j < 8; ++j)
+                            if ((b >> j) & 1) bytes[d][k][b] ^= v[d][8 * k + j];
+                    }
+        }
+    };
+
+    // Built once at startup (a function-local static would be checked on every call)
+    static const DirectionNumbers& directions() { return direction_table; }
+    static inline const DirectionNumbers direction_table{};
+
+    mutable int shuffled_group = -1;       // Group, sample and pixel of the cached shuffled index
+    mutable uint32_t shuffled_for = 0;
+    mutable uint64_t shuffled_pixel = 0;
+    mutable uint32_t shuffled_index = 0;
+
+    static uint32_t reverse_bits(uint32_t x) {
+        x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+        x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+        x = ((x >> 4) & 0x0F0F0F0Fu) | ((x & 0x0F0F0F0Fu) << 4);
+        x = ((x >> 8) & 0x00FF00FFu) | ((x & 0x00FF00FFu) << 8);
+        return (x >> 16) | (x << 16);
+    }
+
+    // Owen scramble of a 32-bit fraction: hashes every bit with the bits above it
+    static uint32_t nested_uniform_scramble(uint32_t x, uint32_t seed) {
+        x = reverse_bits(x);
+        x += seed;
+        x ^= x * 0x6c50b47cu;
+        x ^= x * 0xb82f1e52u;
+        x ^= x * 0xc7afe638u;
+        x ^= x * 0x8d22f6e6u;
+        return reverse_bits(x);
+    }
+};
+
+
+/**
+ * @class BlueNoiseSampler
+ * @brief Rank-1 lattice sequence shifted per pixel by a blue-noise dither mask.
+ *
+ * Sample n of a pixel is frac(n * alpha_d + shift) in dimension d (a Kronecker
+ * sequence): successive samples fill every dimension evenly, and any prefix
+ * is well spread, which suits progressive rendering. The camera pair uses
+ * the R2 generator (1/g, 1/g^2, g the plastic number), the best-spread 2D
+ * rank-1 sequence; the other dimensions use the square roots of the primes,
+ * which are independent over the rationals, so no two dimensions are aligned.
+ *
+ * The shift of pixel (i, j) is the R2 dither mask frac(i / g + j / g^2) plus a
+ * random offset per dimension: neighbouring pixels get well separated shifts,
+ * which spreads the error across the image as blue noise instead of white noise.
+ * Dimensions past `max_dimensions` are independent.
+ */
+class BlueNoiseSampler : public Sampler {
+public:
+    static constexpr int max_dimensions = 64;
+
+    BlueNoiseSampler() {
+        alpha[0] = 1.0 / plastic;
+        alpha[1] = 1.0 / (plastic * plastic);
+        int d = 2;
+        for (int n = 2; d < max_dimensions; ++n) {
+            bool prime = true;
+            for (int k = 2; k * k <= n; ++k)
+                if (n % k == 0) prime = false;
+            if (prime) {
+                double root = std::sqrt(static_cast<double>(n));
+                alpha[d++] = root - std::floor(root);
+            }
+        }
+    }
+
+    std::unique_ptr<Sampler> clone() const override { return std::make_unique<BlueNoiseSampler>(*this); }
+
+protected:
+    double sample(int dim) const override {
+        if (dim >= max_dimensions) return to_unit(hash(dim, 0, index));
+        double mask = px / plastic + py / (plastic * plastic);
+        double value = 0.5 + index * alpha[dim] + mask + to_unit(hash(dim, 4));
+        return value - std::floor(value);
+    }
+
+private:
+    static constexpr double plastic = 1.32471795724474602596; // Root of x^3 = x + 1
+    double alpha[max_dimensions]; // Generator of the sequence
+};
+
+
+// Creates a sampler; `samples_per_pixel` sets the strata of the stratified sampler
+inline std::unique_ptr<Sampler> make_sampler(SamplerType type, int samples_per_pixel) {
+    switch (type) {
+        case SamplerType::Stratified: return std::make_unique<StratifiedSampler>(samples_per_pixel);
+        case SamplerType::Sobol:      return std::make_unique<SobolSampler>();
+        case SamplerType::BlueNoise:  return std::make_unique<BlueNoiseSampler>();
+        default:                      return std::make_unique<IndependentSampler>();
+    }
+}
+
+inline const char* sampler_name(SamplerType type) {
+    switch (type) {
+        case SamplerType::Stratified: return "stratified";
+        case SamplerType::Sobol:      return "sobol";
+        case SamplerType::BlueNoise:  return "bluenoise";
+        default:                      return "independent";
+    }
+}
+
+/**
+ * @brief Parses a sampler name ("independent", "stratified", "sobol", "bluenoise").
+ * @throw std::invalid_argument for an unknown name.
+ */
+inline SamplerType parse_sampler_type(const std::string& name) {
+    if (name == "independent") return SamplerType::Independent;
+    if (name == "stratified") return SamplerType::Stratified;
+    if (name == "sobol") return SamplerType::Sobol;
+    if (name == "bluenoise") return SamplerType::BlueNoise;
+    throw std::invalid_argument("Unknown sampler type: " + name);
+}
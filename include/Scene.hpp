@@ -2,6 +2,7 @@
 #include <vector>
 #include <memory>
 #include "Material.hpp"
+#include "Object.hpp"
 
 using std::shared_ptr;
 using std::make_shared;
@@ -18,11 +19,13 @@ class Scene : public SceneBaseObject {
 public:
     // A list of pointers to SceneBaseObjects
     std::vector<shared_ptr<SceneBaseObject>> objects;
+    // The materials referenced by the objects (through their MaterialId)
+    MaterialTable materials;
 
     Scene() {}
     Scene(shared_ptr<SceneBaseObject> object) { add(object); }
 
-    void clear() { objects.clear(); }
+    void clear() { objects.clear(); materials.clear(); }
     void add(shared_ptr<SceneBaseObject> object) { objects.push_back(object); }
 
     /**
@@ -48,6 +51,33 @@ public:
 
         return hit_anything;
     }
+
+    /**
+     * @brief Checks if ANY object in the list blocks the ray.
+     * No closest hit is needed: the first blocker ends the search.
+     */
+    virtual bool occluded(const Ray& r, double t_min, double t_max) const {
+        for (const auto& object : objects) {
+            if (object->occluded(r, t_min, t_max)) return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief The bounding box of a list is the union of the boxes of its objects.
+     * An empty list, or a list containing an unbounded object, has no box.
+     */
+    virtual bool bounding_box(AABB& output_box) const {
+        if (objects.empty()) return false;
+
+        AABB temp_box;
+        output_box = AABB();
+        for (const auto& object : objects) {
+            if (!object->bounding_box(temp_box)) return false;
+            output_box.expand(temp_box);
+        }
+        return true;
+    }
 };
 
 
@@ -60,7 +90,7 @@ public:
     // Constructor
     // origin: The origin
     // u, v, w: Three edge vectors emanating from the origin
-    Parallelepiped(const Point3& origin, const Vec3& u, const Vec3& v, const Vec3& w, shared_ptr<Material> m) {
+    Parallelepiped(const Point3& origin, const Vec3& u, const Vec3& v, const Vec3& w, MaterialId m) {
         // We use the add method of the Scene class to add the 6 faces, forming a hexahedron.        
         add(make_shared<Parallelogram>(origin, u, v, m));
         add(make_shared<Parallelogram>(origin + w, u, v, m));
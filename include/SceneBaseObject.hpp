@@ -1,9 +1,15 @@
 #pragma once
 #include "Utils.hpp"
+#include <cstdint>
+#include "AABB.hpp"
+#include "RayPacket.hpp"
 
 
 class Material;
 
+// Index of a material in the scene's MaterialTable
+using MaterialId = uint32_t;
+
 /**
  * @struct HitRecord
  * @brief A structure to store detailed information about a ray-object intersection.
@@ -14,13 +20,16 @@ class Material;
  * 3. The distance along the ray (t).
  * 4. Whether the hit was on the front or back face.
  * 5. The material of the hit point
+ *
+ * The material is stored as an index into the scene's MaterialTable rather
+ * than a shared_ptr, so copying a HitRecord never touches a reference count.
  */
 struct HitRecord {
     Point3 p;                     // The intersection point in 3D space
     Vec3 normal;                  // The surface normal vector at point p
     double t;                     // The ray parameter t where intersection occurred
     bool front_face;              // True if ray hits the outside surface, False if inside
-    shared_ptr<Material> mat_ptr; // Material of the hit point
+    MaterialId mat_id;            // Material of the hit point (index in the MaterialTable)
 
     /**
      * @brief Determines the face normal direction.
@@ -58,4 +67,44 @@ public:
      * @return true if the ray hits the object, false otherwise.
      */
     virtual bool hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const = 0;
+
+    /**
+     * @brief Determines if anything blocks the ray within [t_min, t_max] (any-hit query).
+     * 
+     * Used for shadow rays: it may stop at the first intersection found, whichever
+     * it is, and never computes the hit point, the normal or the material.
+     * 
+     * @param r The ray being cast.
+     * @param t_min The minimum valid distance.
+     * @param t_max The maximum valid distance (e.g. the distance to the light).
+     * @return true if the ray hits the object, false otherwise.
+     */
+    virtual bool occluded(const Ray& r, double t_min, double t_max) const = 0;
+
+    /**
+     * @brief Finds the closest hit of every ray of a packet (rays with a common origin).
+     * 
+     * The default traces the rays one by one; acceleration structures override it
+     * to traverse their tree once for the whole packet.
+     * 
+     * @param packet The rays, with finish() already called.
+     * @param t_min The minimum valid distance.
+     * @param t_max The maximum valid distance.
+     * @param recs Receives the HitRecord of each ray that hits (packet.size entries).
+     * @param hits Receives whether each ray hits the object (packet.size entries).
+     */
+    virtual void hit_packet(const RayPacket& packet, double t_min, double t_max, HitRecord* recs, bool* hits) const {
+        for (int k = 0; k < packet.size; ++k)
+            hits[k] = hit(packet.ray(k), t_min, t_max, recs[k]);
+    }
+
+    /**
+     * @brief Computes the axis-aligned box enclosing this object.
+     * 
+     * Used to build the bounding volume hierarchy (BVH).
+     * 
+     * @param output_box Reference to an AABB to store the bounding box.
+     * @return true if the object is bounded, false if it is infinite (e.g. Plane).
+     */
+    virtual bool bounding_box(AABB& output_box) const = 0;
 };
\ No newline at end of file
@@ -0,0 +1,71 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <ostream>
+#include "Accelerator.hpp"
+#include "Light.hpp"
+#include "RenderUtils.hpp"
+
+/**
+ * @struct CompiledScene
+ * @brief A scene ready to render: materials, lights, acceleration structure, camera and background.
+ */
+struct CompiledScene {
+    MaterialTable materials;
+    LightList lights;
+    shared_ptr<SceneBaseObject> world;
+    CameraConfig cam_config;
+    Color bg_color = Color(0.05, 0.05, 0.1); // Default background color
+    size_t object_count = 0;                 // Objects of the scene file
+    bool from_cache = false;                 // Loaded from the compiled cache instead of the XML
+};
+
+/**
+ * @class SceneCache
+ * @brief Compiled copy of a scene file, reloaded without parsing or building anything.
+ *
+ * After an XML scene is parsed and its BVH built, the result is written next
+ * to it (`beach.xml` -> `beach.rtscene`) as a versioned binary file: a header,
+ * then flat arrays of plain data: materials, emissive spheres, BVH nodes, the
+ * sphere SoA columns, parallelograms and planes, each padded to 8 bytes.
+ * Loading maps the file (MappedFile) and copies the arrays into place, so the
+ * cost is that of a memcpy of the scene. Every node offset, leaf range and
+ * material id is checked against the array it indexes; a cache that fails a
+ * check is ignored.
+ *
+ * The cache records the size, modification time and a 64-bit hash of the XML
+ * it was built from. It is used when the size and time still match, or when
+ * only the time changed but the content hash is the same (the new time is then
+ * written into the cache, so the file is not hashed again on the next load);
+ * otherwise the XML is parsed again and the cache rewritten. A cache written by another version of
+ * the program, or with another SIMD width (SphereSoA::lane_width), is ignored.
+ */
+class SceneCache {
+public:
+    // Path of the cache of a scene file: the XML path with the extension .rtscene
+    static std::string path_for(const std::string& xml_path);
+
+    /**
+     * @brief Loads a scene file, through its compiled cache when that is up to date.
+     *
+     * Otherwise parses the XML, builds the scene and writes the cache; a cache
+     * that cannot be written (e.g. read-only directory) is only reported in the log.
+     *
+     * @param accel The acceleration structure to trace against (the cache holds the
+     *              binary BVH, which the 4-wide BVH is collapsed from).
+     * @param log Receives one line on how the scene was loaded.
+     * @throw std::runtime_error if the XML cannot be read or parsed.
+     */
+    static CompiledScene load(const std::string& xml_path, AcceleratorType accel, std::ostream& log);
+
+    // Size, modification time (ns) and content hash of a scene file, recorded in its cache
+    struct SourceStamp {
+        uint64_t size = 0;
+        int64_t mtime = 0;
+        uint64_t hash = 0;
+    };
+
+private:
+    static bool read(const std::string& cache_path, const std::string& xml_path, CompiledScene& scene, BVH& tree);
+    static bool write(const std::string& cache_path, const SourceStamp& source, const CompiledScene& scene, const BVH& tree);
+};
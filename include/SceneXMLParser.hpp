@@ -3,27 +3,39 @@
 
 #include <string>
 #include <vector>
-#include <unordered_map>
-#include <regex>
-#include <fstream>
-#include <sstream>
-#include <algorithm>
+#include <string_view>
+#include <cstdint>
+#include "Vec3.hpp"
+#include "XMLTokenizer.hpp"
 
-// Generic property mapping (key-value)
-using AttrMap = std::unordered_map<std::string, std::string>;
-using NestedAttrMap = std::unordered_map<std::string, AttrMap>;
+// The parser emits a typed scene description: numbers are converted (std::from_chars)
+// as the tags are read, so the scene conversion only copies values.
+
+// Material types of the scene files
+enum class MaterialType : uint8_t { Matte, Metal, Glass, Light, Unknown };
+
+// Object types of the scene files
+enum class ObjectType : uint8_t { Sphere, Plane, Parallelepiped, Unknown };
 
 // Material Structure
 struct MaterialObject {
-    std::string type;          // Material type: matte/metal/glass
-    NestedAttrMap properties;  // Material properties (color/ior/fuzz, etc.)
+    MaterialType type = MaterialType::Unknown;
+    std::string type_name;  // Material type as written in the file (matte/metal/glass/light)
+    Color color;            // <color r g b/>, divided by 255 (matte, metal)
+    float fuzz = 0.0f;      // <fuzz value/> (metal)
+    float ior = 1.0f;       // <ior value/> (glass)
+    float intensity = 0.0f; // <intensity value/> (light)
 };
 
 // Scene object structure
 struct SceneObject {
     std::string id;
-    std::string type;
-    NestedAttrMap properties;  // Sub-properties such as position, size, and color
+    ObjectType type = ObjectType::Unknown;
+    Point3 position;      // Sphere center, point of a plane
+    float radius = 0.0f;  // Sphere
+    Vec3 normal;          // Plane
+    Point3 origin;        // Parallelepiped corner
+    Vec3 u, v, w;         // Parallelepiped edges
     MaterialObject material;
 };
 
@@ -31,12 +43,17 @@ struct SceneObject {
 struct Camera {
     std::string id;
     std::string type;
-    NestedAttrMap properties;  // Sub-attributes such as position/look_at/fov
+    bool defined = false;            // The file sets the camera parameters
+    Point3 position;
+    float focal_length = 1.0f;
+    float viewport_height = 2.0f;
+    float aspect_ratio = 16.0f / 9.0f; // <aspect_ratio value/>, which may be a fraction such as 16.0/9.0
 };
 
 // Global settings structure
 struct GlobalSettings {
-    NestedAttrMap properties; // Sub-properties like background_color/scene_size
+    bool has_background_color = false;
+    Color background_color;  // Divided by 255
 };
 
 // Main structure holding all scene data
@@ -47,32 +64,42 @@ struct SceneData {
 };
 
 // XML Parser Class
+// The document is read in one pass by an XMLTokenizer, whose tags are views into the text;
+// comments are skipped by the tokenizer, so the document is never copied.
+// Throws std::runtime_error when a number is malformed or a required property is missing.
 class SceneXMLParser {
 public:
-    // Parses an XML file
+    // Parses an XML file, memory-mapped and read in place
     SceneData parseFile(const std::string& filePath);
     // Parses an XML string content
     SceneData parseString(const std::string& xmlContent);
 
 private:
-    // Removes XML comments
-    std::string removeComments(const std::string& xml);
-    // Parses attribute strings (e.g., r="255" g="255" b="255")
-    AttrMap parseAttributes(const std::string& attrStr);
+    friend class SceneCache; // Parses the mapping it hashes (parseText)
+
+    // Parses XML text in place (e.g. a mapped file), which must stay valid during the call
+    SceneData parseText(std::string_view xmlContent);
+
+    // Tag whose sub-tags are being read
+    enum class ParentTag { None, GlobalSettings, Object, Camera, Material, Other };
+
     // Processes start tags (<tag ...>)
-    void processStartTag(const std::string& tagContent);
+    void processStartTag(const XMLTag& tag);
     // Processes end tags (</tag>)
-    void processEndTag(const std::string& tagName);
+    void processEndTag(const XMLTag& tag);
     // Processes self-closing tags (<tag .../>)
-    void processSelfClosingTag(const std::string& tagContent);
+    void processSelfClosingTag(const XMLTag& tag);
 
     // Temporary state variables
     SceneData m_sceneData;
-    std::string m_currentParentTag; // Current parent tag (global_settings/object/camera)
+    ParentTag m_currentParentTag = ParentTag::None; // Current parent tag (global_settings/object/camera/material)
     SceneObject m_currentObject;    // Temporarily stores the object currently being parsed
     Camera m_currentCamera;         // Temporarily stores the camera currently being parsed
     GlobalSettings m_currentGlobal; // Temporarily stores the global settings currently being parsed
     MaterialObject m_currentMaterial; // Temporarily stores the material currently being parsed
+    unsigned m_objectFields = 0;    // Sub-tags seen in the current object (bit mask)
+    unsigned m_materialFields = 0;  // Sub-tags seen in the current material (bit mask)
+    unsigned m_cameraFields = 0;    // Sub-tags seen in the current camera (bit mask)
 };
 
-#endif // SCENE_XML_PARSER_H
\ No newline at end of file
+#endif // SCENE_XML_PARSER_H
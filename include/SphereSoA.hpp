@@ -0,0 +1,216 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#include "Object.hpp"
+
+/**
+ * @class SphereSoA
+ * @brief Spheres stored as a Structure of Arrays, intersected several at a time.
+ *
+ * Instead of one Sphere object (vtable, Vec3 center, radius, material) per
+ * sphere, the centers and radii live in separate contiguous double arrays.
+ * `nearest_hit()` tests a range of spheres with one SIMD lane per sphere:
+ * 4 spheres per instruction with AVX, 2 with SSE2, and a scalar loop otherwise.
+ * It performs the same arithmetic as `Sphere::hit()` and only builds the
+ * HitRecord (`fill_record()`) for the single nearest sphere. `any_hit()` runs
+ * the same kernel for shadow rays and returns at the first batch with a hit.
+ *
+ * `pad()` appends dummy spheres (NaN center, never hit) so that a range can be
+ * rounded up to a multiple of `lane_width` and processed without a scalar tail.
+ */
+class SphereSoA {
+public:
+#if defined(__AVX__)
+    static constexpr uint32_t lane_width = 4;
+#elif defined(__SSE2__)
+    static constexpr uint32_t lane_width = 2;
+#else
+    static constexpr uint32_t lane_width = 1;
+#endif
+
+    std::vector<double> center_x, center_y, center_z; // Sphere centers
+    std::vector<double> radius;                        // Sphere radii
+    std::vector<MaterialId> materials;                 // Material of each sphere
+
+    size_t size() const { return radius.size(); }
+
+    void add(const Sphere& s) {
+        center_x.push_back(s.center.x());
+        center_y.push_back(s.center.y());
+        center_z.push_back(s.center.z());
+        radius.push_back(s.radius);
+        materials.push_back(s.mat_id);
+    }
+
+    // Append dummy spheres until the size is a multiple of lane_width
+    void pad() {
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+        while (size() % lane_width != 0) {
+            center_x.push_back(nan);
+            center_y.push_back(nan);
+            center_z.push_back(nan);
+            radius.push_back(0.0);
+            materials.push_back(0);
+        }
+    }
+
+    /**
+     * @brief Finds the nearest sphere in [begin, begin + count) hit by the ray.
+     * @param t_max Upper bound of the valid range; updated to the nearest hit distance.
+     * @return The index of the nearest sphere hit, or -1 if none is hit in [t_min, t_max].
+     */
+    int nearest_hit(const Ray& r, uint32_t begin, uint32_t count, double t_min, double& t_max) const {
+        return intersect<false>(r, begin, count, t_min, t_max);
+    }
+
+    /**
+     * @brief Checks if any sphere in [begin, begin + count) is hit within [t_min, t_max].
+     * Stops at the first batch with a hit; used for shadow rays.
+     */
+    bool any_hit(const Ray& r, uint32_t begin, uint32_t count, double t_min, double t_max) const {
+        return intersect<true>(r, begin, count, t_min, t_max) >= 0;
+    }
+
+    // Builds the HitRecord of sphere `index` hit by the ray at distance t
+    void fill_record(int index, const Ray& r, double t, HitRecord& rec) const {
+        Point3 center(center_x[index], center_y[index], center_z[index]);
+        rec.t = t;
+        rec.p = r.at(t);
+        Vec3 outward_normal = (rec.p - center) / radius[index];
+        rec.set_face_normal(r, outward_normal);
+        rec.mat_id = materials[index];
+    }
+
+private:
+    // Shared kernel: nearest hit, or (first_hit) the first sphere found within [t_min, t_max]
+    template <bool first_hit>
+    int intersect(const Ray& r, uint32_t begin, uint32_t count, double t_min, double& t_max) const {
+        const Point3 o = r.origin();
+        const Vec3 d = r.direction();
+        const double a = d.length_squared();
+        int best = -1;
+        uint32_t i = begin;
+        const uint32_t end = begin + count;
+
+#if defined(__AVX__)
+        const __m256d ox = _mm256_set1_pd(o[0]), oy = _mm256_set1_pd(o[1]), oz = _mm256_set1_pd(o[2]);
+        const __m256d dx = _mm256_set1_pd(d[0]), dy = _mm256_set1_pd(d[1]), dz = _mm256_set1_pd(d[2]);
+        const __m256d va = _mm256_set1_pd(a);
+        const __m256d vt_min = _mm256_set1_pd(t_min);
+        const __m256d zero = _mm256_setzero_pd();
+
+        for (; i + 4 <= end; i += 4) {
+            __m256d ocx = _mm256_sub_pd(ox, _mm256_loadu_pd(&center_x[i]));
+            __m256d ocy = _mm256_sub_pd(oy, _mm256_loadu_pd(&center_y[i]));
+            __m256d ocz = _mm256_sub_pd(oz, _mm256_loadu_pd(&center_z[i]));
+            __m256d rad = _mm256_loadu_pd(&radius[i]);
+
+            __m256d half_b = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(ocx, dx), _mm256_mul_pd(ocy, dy)), _mm256_mul_pd(ocz, dz));
+            __m256d c = _mm256_sub_pd(
+                _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(ocx, ocx), _mm256_mul_pd(ocy, ocy)), _mm256_mul_pd(ocz, ocz)),
+                _mm256_mul_pd(rad, rad));
+            __m256d discriminant = _mm256_sub_pd(_mm256_mul_pd(half_b, half_b), _mm256_mul_pd(va, c));
+            __m256d valid = _mm256_cmp_pd(discriminant, zero, _CMP_GE_OQ);
+            if (_mm256_movemask_pd(valid) == 0) continue;
+
+            __m256d sqrtd = _mm256_sqrt_pd(_mm256_max_pd(discriminant, zero));
+            __m256d neg_half_b = _mm256_sub_pd(zero, half_b);
+            __m256d root1 = _mm256_div_pd(_mm256_sub_pd(neg_half_b, sqrtd), va);
+            __m256d root2 = _mm256_div_pd(_mm256_add_pd(neg_half_b, sqrtd), va);
+
+            const __m256d vt_max = _mm256_set1_pd(t_max);
+            __m256d in1 = _mm256_and_pd(_mm256_cmp_pd(root1, vt_min, _CMP_GE_OQ), _mm256_cmp_pd(root1, vt_max, _CMP_LE_OQ));
+            __m256d in2 = _mm256_and_pd(_mm256_cmp_pd(root2, vt_min, _CMP_GE_OQ), _mm256_cmp_pd(root2, vt_max, _CMP_LE_OQ));
+            __m256d root = _mm256_blendv_pd(root2, root1, in1);
+            int mask = _mm256_movemask_pd(_mm256_and_pd(valid, _mm256_or_pd(in1, in2)));
+            if (mask == 0) continue;
+            if (first_hit) {
+                int lane = 0;
+                while (!(mask & (1 << lane))) ++lane;
+                return static_cast<int>(i) + lane;
+            }
+
+            // Few lanes survive: pick the nearest one in scalar code
+            alignas(32) double roots[4];
+            _mm256_store_pd(roots, root);
+            for (int lane = 0; lane < 4; ++lane) {
+                if ((mask & (1 << lane)) && roots[lane] < t_max) {
+                    t_max = roots[lane];
+                    best = static_cast<int>(i) + lane;
+                }
+            }
+        }
+#elif defined(__SSE2__)
+        const __m128d ox = _mm_set1_pd(o[0]), oy = _mm_set1_pd(o[1]), oz = _mm_set1_pd(o[2]);
+        const __m128d dx = _mm_set1_pd(d[0]), dy = _mm_set1_pd(d[1]), dz = _mm_set1_pd(d[2]);
+        const __m128d va = _mm_set1_pd(a);
+        const __m128d vt_min = _mm_set1_pd(t_min);
+        const __m128d zero = _mm_setzero_pd();
+
+        for (; i + 2 <= end; i += 2) {
+            __m128d ocx = _mm_sub_pd(ox, _mm_loadu_pd(&center_x[i]));
+            __m128d ocy = _mm_sub_pd(oy, _mm_loadu_pd(&center_y[i]));
+            __m128d ocz = _mm_sub_pd(oz, _mm_loadu_pd(&center_z[i]));
+            __m128d rad = _mm_loadu_pd(&radius[i]);
+
+            __m128d half_b = _mm_add_pd(_mm_add_pd(_mm_mul_pd(ocx, dx), _mm_mul_pd(ocy, dy)), _mm_mul_pd(ocz, dz));
+            __m128d c = _mm_sub_pd(
+                _mm_add_pd(_mm_add_pd(_mm_mul_pd(ocx, ocx), _mm_mul_pd(ocy, ocy)), _mm_mul_pd(ocz, ocz)),
+                _mm_mul_pd(rad, rad));
+            __m128d discriminant = _mm_sub_pd(_mm_mul_pd(half_b, half_b), _mm_mul_pd(va, c));
+            __m128d valid = _mm_cmpge_pd(discriminant, zero);
+            if (_mm_movemask_pd(valid) == 0) continue;
+
+            __m128d sqrtd = _mm_sqrt_pd(_mm_max_pd(discriminant, zero));
+            __m128d neg_half_b = _mm_sub_pd(zero, half_b);
+            __m128d root1 = _mm_div_pd(_mm_sub_pd(neg_half_b, sqrtd), va);
+            __m128d root2 = _mm_div_pd(_mm_add_pd(neg_half_b, sqrtd), va);
+
+            const __m128d vt_max = _mm_set1_pd(t_max);
+            __m128d in1 = _mm_and_pd(_mm_cmpge_pd(root1, vt_min), _mm_cmple_pd(root1, vt_max));
+            __m128d in2 = _mm_and_pd(_mm_cmpge_pd(root2, vt_min), _mm_cmple_pd(root2, vt_max));
+            __m128d root = _mm_or_pd(_mm_and_pd(in1, root1), _mm_andnot_pd(in1, root2));
+            int mask = _mm_movemask_pd(_mm_and_pd(valid, _mm_or_pd(in1, in2)));
+            if (mask == 0) continue;
+            if (first_hit) {
+                int lane = 0;
+                while (!(mask & (1 << lane))) ++lane;
+                return static_cast<int>(i) + lane;
+            }
+
+            alignas(16) double roots[2];
+            _mm_store_pd(roots, root);
+            for (int lane = 0; lane < 2; ++lane) {
+                if ((mask & (1 << lane)) && roots[lane] < t_max) {
+                    t_max = roots[lane];
+                    best = static_cast<int>(i) + lane;
+                }
+            }
+        }
+#endif
+
+        // Scalar fallback (and tail of ranges that are not padded)
+        for (; i < end; ++i) {
+            double ocx = o[0] - center_x[i], ocy = o[1] - center_y[i], ocz = o[2] - center_z[i];
+            double half_b = ocx * d[0] + ocy * d[1] + ocz * d[2];
+            double c = ocx * ocx + ocy * ocy + ocz * ocz - radius[i] * radius[i];
+            double discriminant = half_b * half_b - a * c;
+            if (!(discriminant >= 0)) continue;
+
+            double sqrtd = sqrt(discriminant);
+            double root = (-half_b - sqrtd) / a;
+            if (root < t_min || t_max < root) {
+                root = (-half_b + sqrtd) / a;
+                if (root < t_min || t_max < root) continue;
+            }
+            if (first_hit) return static_cast<int>(i);
+            t_max = root;
+            best = static_cast<int>(i);
+        }
+
+        return best;
+    }
+};
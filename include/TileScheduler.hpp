@@ -0,0 +1,177 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <algorithm>
+#include <ostream>
+
+/**
+ * @struct Tile
+ * @brief A rectangle of pixels [x0, x1) x [y0, y1), rendered as one work item.
+ * Rows are counted from the top of the image, as in the pixel buffer.
+ */
+struct Tile {
+    int index;  // Position of the tile in TileScheduler::tiles()
+    int x0, y0; // First pixel (inclusive)
+    int x1, y1; // Last pixel (exclusive)
+};
+
+
+/**
+ * @class TileScheduler
+ * @brief Splits an image into small square tiles and hands them out to threads with work stealing.
+ *
+ * The tiles are ordered along a Morton (Z-order) curve, so that consecutive
+ * tiles are close on screen and share the geometry they hit. They are then
+ * dealt round-robin into one deque per thread: every thread starts with its
+ * share spread over the whole image, and expensive regions are split between
+ * all threads from the start.
+ *
+ * A thread takes tiles from the front of its own deque. When it is empty, it
+ * steals from the back of the other deques, so no thread idles while work is
+ * left and the tail of the render is at most one tile long. Each deque has its
+ * own mutex: contention is only possible while stealing, once per tile.
+ *
+ * The time spent on every tile is recorded (`record()`) and can be summarised
+ * with `print_report()` to find the expensive regions and the load imbalance.
+ *
+ * The scheduler does not start any thread: it works the same whether the
+ * workers are OpenMP threads or std::threads.
+ */
+class TileScheduler {
+public:
+    static constexpr int default_tile_size = 16;
+
+    TileScheduler(int image_width, int image_height, int num_threads, int tile_size = default_tile_size)
+        : width(image_width), height(image_height), size(tile_size),
+          num_queues(std::max(1, num_threads)), queues(new WorkQueue[std::max(1, num_threads)]) {
+        // 1. Cut the image into tiles (the last row/column of tiles may be smaller)
+        int tiles_x = (width + size - 1) / size;
+        int tiles_y = (height + size - 1) / size;
+        std::vector<std::pair<uint32_t, Tile>> ordered;
+        for (int ty = 0; ty < tiles_y; ++ty) {
+            for (int tx = 0; tx < tiles_x; ++tx) {
+                Tile tile{0, tx * size, ty * size, std::min(width, (tx + 1) * size), std::min(height, (ty + 1) * size)};
+                ordered.push_back({morton_code(tx, ty), tile});
+            }
+        }
+
+        // 2. Z-order, then deal round-robin into the per-thread deques
+        std::sort(ordered.begin(), ordered.end(),
+                  [](const auto& a, const auto& b) { return a.first < b.first; });
+        tile_list.reserve(ordered.size());
+        for (auto& entry : ordered) {
+            entry.second.index = static_cast<int>(tile_list.size());
+            queues[tile_list.size() % num_queues].tiles.push_back(entry.second.index);
+            tile_list.push_back(entry.second);
+        }
+
+        tile_seconds.assign(tile_list.size(), 0.0);
+        tile_thread.assign(tile_list.size(), -1);
+    }
+
+    /**
+     * @brief Gets the next tile for a thread: its own work first, then stolen work.
+     * @param thread_id The calling thread, in [0, num_threads).
+     * @param tile Receives the tile to render.
+     * @return false once no tile is left anywhere.
+     */
+    bool next(int thread_id, Tile& tile) {
+        int own = thread_id % num_queues;
+        {
+            WorkQueue& queue = queues[own];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tiles.empty()) {
+                tile = tile_list[queue.tiles.front()];
+                queue.tiles.pop_front();
+                return true;
+            }
+        }
+
+        // Own deque is empty: steal from the back of the others, nearest neighbour first
+        for (int k = 1; k < num_queues; ++k) {
+            WorkQueue& victim = queues[(own + k) % num_queues];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tiles.empty()) {
+                tile = tile_list[victim.tiles.back()];
+                victim.tiles.pop_back();
+                steal_count.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Records the time a thread spent on a tile (each tile is rendered once, so no lock is needed)
+    void record(const Tile& tile, int thread_id, double seconds) {
+        tile_seconds[tile.index] = seconds;
+        tile_thread[tile.index] = thread_id;
+    }
+
+    const std::vector<Tile>& tiles() const { return tile_list; }
+    size_t tile_count() const { return tile_list.size(); }
+    int tile_size() const { return size; }
+    int steals() const { return steal_count.load(std::memory_order_relaxed); }
+
+    // Time spent on each tile, indexed like tiles()
+    const std::vector<double>& tile_times() const { return tile_seconds; }
+
+    /**
+     * @brief Prints the tile statistics of the last render.
+     * Reports the tile count, the number of steals, the cheapest/average/most
+     * expensive tile and the busy time of each thread (its load balance).
+     */
+    void print_report(std::ostream& out) const {
+        if (tile_list.empty()) return;
+
+        size_t slowest = 0, fastest = 0;
+        double total = 0.0;
+        std::vector<double> busy(num_queues, 0.0);
+        for (size_t i = 0; i < tile_list.size(); ++i) {
+            total += tile_seconds[i];
+            if (tile_seconds[i] > tile_seconds[slowest]) slowest = i;
+            if (tile_seconds[i] < tile_seconds[fastest]) fastest = i;
+            if (tile_thread[i] >= 0) busy[tile_thread[i] % num_queues] += tile_seconds[i];
+        }
+        auto busiest = std::minmax_element(busy.begin(), busy.end());
+
+        out << "Tiles: " << tile_list.size() << " (" << size << "x" << size << "), "
+            << steals() << " stolen\n"
+            << "Tile time: min " << tile_seconds[fastest] * 1e3 << " ms, avg "
+            << total / tile_list.size() * 1e3 << " ms, max " << tile_seconds[slowest] * 1e3
+            << " ms at (" << tile_list[slowest].x0 << ", " << tile_list[slowest].y0 << ")\n"
+            << "Thread busy time: min " << *busiest.first << " s, max " << *busiest.second << " s\n";
+    }
+
+private:
+    // Interleaves the bits of x and y (Z-order curve)
+    static uint32_t morton_code(uint32_t x, uint32_t y) {
+        auto spread = [](uint32_t v) {
+            v &= 0x0000FFFF;
+            v = (v | (v << 8)) & 0x00FF00FF;
+            v = (v | (v << 4)) & 0x0F0F0F0F;
+            v = (v | (v << 2)) & 0x33333333;
+            v = (v | (v << 1)) & 0x55555555;
+            return v;
+        };
+        return spread(x) | (spread(y) << 1);
+    }
+
+    // One deque per thread, on its own cache line to avoid false sharing between mutexes
+    struct alignas(64) WorkQueue {
+        std::mutex mutex;
+        std::deque<int> tiles; // Indices into tile_list
+    };
+
+    int width, height;                   // Image size in pixels
+    int size;                            // Tile side in pixels
+    int num_queues;                      // One per thread
+    std::unique_ptr<WorkQueue[]> queues; // Per-thread deques
+    std::vector<Tile> tile_list;         // All tiles, in Morton order
+    std::vector<double> tile_seconds;    // Render time of each tile
+    std::vector<int> tile_thread;        // Thread that rendered each tile
+    std::atomic<int> steal_count{0};     // Number of tiles taken from another thread
+};
@@ -3,8 +3,7 @@
 #include <limits>
 #include <memory>
 #include <cstdlib>
-#include <random>
-#include <omp.h>
+#include <cstdint>
 #include "Vec3.hpp"
 #include "Ray.hpp"
 
@@ -23,12 +22,41 @@ inline double degrees_to_radians(double degrees) {
     return degrees * pi / 180.0;
 }
 
-// Returns a random real in [0,1).
+// ----------------------------------- Random Numbers -----------------------------------
+// Random numbers are counter-based: the n-th number drawn by a sample is a hash of
+// (pixel, sample index, n), so an image does not depend on which thread rendered which
+// tile, or in which order. The renderer calls start_sample() before tracing each sample.
+
+// Random stream of the current thread: the hashed (pixel, sample) key and the next dimension
+struct RandomStream {
+    uint64_t key = 0;
+    uint64_t dimension = 0;
+};
+
+inline RandomStream& random_stream() {
+    static thread_local RandomStream stream;
+    return stream;
+}
+
+// SplitMix64 finalizer: a bijective 64-bit hash with good avalanche
+inline uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Starts the random sequence of sample `sample` of pixel `pixel` on the current thread
+inline void start_sample(uint64_t pixel, uint64_t sample) {
+    RandomStream& stream = random_stream();
+    stream.key = mix64(mix64(pixel + 0x9E3779B97F4A7C15ull) ^ sample);
+    stream.dimension = 0;
+}
+
+// Returns a random real in [0,1): the next dimension of the current sample.
 inline double _random_double() {
-    // thread_local 确保每个线程只初始化一次这个生成器
-    static thread_local std::mt19937 generator(std::random_device{}() + omp_get_thread_num());
-    static std::uniform_real_distribution<double> distribution(0.0, 1.0);
-    return distribution(generator);
+    RandomStream& stream = random_stream();
+    uint64_t bits = mix64(stream.key + (++stream.dimension) * 0x9E3779B97F4A7C15ull);
+    return static_cast<double>(bits >> 11) * 0x1.0p-53; // 53 random mantissa bits
 }
 
 inline double random_double(double min=0, double max=1) {
@@ -64,4 +92,17 @@ inline Vec3 refract(const Vec3& v, const Vec3& n, double eta) {
     Vec3 r_out_perp =  eta * (v + cos_theta*n);
     Vec3 r_out_parallel = -sqrt(fabs(1.0 - r_out_perp.length_squared())) * n;
     return r_out_perp + r_out_parallel;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Builds two unit vectors u, v such that (u, v, n) is an orthonormal basis.
+ * Branchless construction of Duff et al. (2017), stable for every unit vector n.
+ * @param n The unit vector the basis is built around.
+ */
+inline void orthonormal_basis(const Vec3& n, Vec3& u, Vec3& v) {
+    double sign = std::copysign(1.0, n.z());
+    double a = -1.0 / (sign + n.z());
+    double b = n.x() * n.y() * a;
+    u = Vec3(1.0 + sign * n.x() * n.x() * a, sign * b, -sign * n.x());
+    v = Vec3(b, sign + n.y() * n.y() * a, -n.y());
+}
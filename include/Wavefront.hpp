@@ -0,0 +1,44 @@
+#pragma once
+#include "RenderUtils.hpp"
+
+/**
+ * @brief Renders tiles of the image for one thread with a wavefront (breadth-first) path tracer.
+ *
+ * Instead of following each sample to its end before starting the next one, the
+ * thread gathers the paths of several tiles (about `wavefront_batch_paths`) and
+ * advances all of them one bounce at a time:
+ *
+ * 1. intersect every live path with the scene;
+ * 2. bin the hits by material type (counting sort), so that each kind of material
+ *    is shaded in one run of identical code, with predictable branches;
+ * 3. shade each bin with shade_hit (emission, light sampling, scattering, Russian roulette);
+ * 4. trace the shadow rays of the bounce in one batch of occluded() queries;
+ * 5. compact the surviving paths into the list of the next bounce.
+ *
+ * The paths read the same sampler dimensions as with ray_color and their samples
+ * are added to the film in the same order, so the image is the same as with
+ * render_blocks_round_robin. Parameters and the tile/progress/cancel/adaptive
+ * behaviour are also the same, except that tiles are completed (and reported to
+ * `progress`) batch by batch, and a cancelled batch adds nothing to the film.
+ */
+void render_blocks_wavefront(
+    int thread_id,
+    TileScheduler& scheduler,
+    const SceneBaseObject& world,
+    const MaterialTable& materials,
+    const LightList& lights,
+    const Point3& origin, const Vec3& horizontal, const Vec3& vertical,
+    const Point3& lower_left_corner,
+    int image_width, int image_height,
+    int samples_per_pixel, int max_depth, int rr_min_depth,
+    const Color& bg_color,
+    Film& film,
+    std::atomic<int>& completed_tiles,
+    const ProgressCallback& progress = nullptr,
+    const std::atomic<bool>* cancel = nullptr,
+    const AdaptiveSampling* adaptive = nullptr,
+    const Sampler* sampler = nullptr
+);
+
+// Paths gathered per batch (tiles are added until the batch holds at least this many)
+constexpr size_t wavefront_batch_paths = 16384;
@@ -0,0 +1,126 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <limits>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#include "BVH.hpp"
+
+// Bound on the relative error of n rounded float operations (PBRT's gamma(n), u = epsilon / 2)
+constexpr float float_gamma(int n) {
+    constexpr float u = std::numeric_limits<float>::epsilon() * 0.5f;
+    return (n * u) / (1 - n * u);
+}
+
+/**
+ * @struct WideBVHNode
+ * @brief A node of the 4-wide BVH (QBVH): the boxes of its four children in SoA form.
+ *
+ * The bounds of the four children are stored per axis and per side, so that
+ * one SSE instruction processes the same slab of all four children at once.
+ * Each child is either another WideBVHNode, a leaf (a leaf node of the binary
+ * BVH, whose primitives are reused as-is), or empty (inverted box, never hit).
+ */
+struct alignas(64) WideBVHNode {
+    static constexpr uint32_t leaf_flag = 0x80000000u;  // Child is a leaf of the binary BVH
+    static constexpr uint32_t empty_child = 0xFFFFFFFFu; // Unused child slot
+
+    float bounds[2][3][4]; // [min/max][axis][child]
+    uint32_t child[4];     // Wide node index, or (leaf_flag | binary node index), or empty_child
+};
+
+
+/**
+ * @class WideBVH
+ * @brief A 4-wide BVH, selectable at runtime next to the binary BVH.
+ *
+ * The tree is obtained by collapsing the binary SAH tree: starting from two
+ * children, the child with the largest surface area is repeatedly replaced by
+ * its own two children until a node has four. Traversal tests the four child
+ * boxes of a node with one SSE slab test (a scalar loop without SSE) and pushes
+ * the hit children far-to-near on a fixed-size stack.
+ *
+ * The slab test runs in single precision but stays conservative: the origin is
+ * rounded to the floats on either side of it and every far distance is widened
+ * by 1 + 2 * gamma(3), so a box the exact ray hits, even on an edge, is never skipped.
+ *
+ * Leaves are the leaves of the binary BVH, so primitives (sphere SoA batches,
+ * Parallelograms) are intersected by exactly the same code, and the infinite
+ * planes are kept outside the tree in the same way.
+ */
+class WideBVH : public SceneBaseObject {
+public:
+    static constexpr int stack_size = 3 * BVH::stack_size; // Up to three siblings pushed per level
+
+    explicit WideBVH(const Scene& scene);
+    // Collapses an already built binary tree (e.g. reloaded from a scene cache)
+    explicit WideBVH(BVH tree);
+
+    virtual bool hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const override;
+    virtual bool occluded(const Ray& r, double t_min, double t_max) const override;
+    virtual bool bounding_box(AABB& output_box) const override;
+
+    size_t primitive_count() const { return binary.primitive_count(); }
+    size_t node_count() const { return nodes.size(); }
+
+private:
+    uint32_t collapse(uint32_t binary_index);
+
+    // Each slab's far distance is scaled by this before the min, so that the rounding of
+    // (bound - origin) * inv_dir cannot push it below another slab's near distance on an edge hit
+    static constexpr float far_widening = 1 + 2 * float_gamma(3);
+
+    // Ray data shared by all the box tests of one traversal
+    struct RayPacket4 {
+        // The double origin rounded to float one ulp either way, so that the near distances
+        // are never above and the far distances never below those of the exact ray
+        float near_origin[3];
+        float far_origin[3];
+        float inv_dir[3];
+        int near_side[3]; // 0 if the ray goes towards +axis (enter through min), 1 otherwise
+
+        explicit RayPacket4(const Ray& r);
+    };
+
+    /**
+     * @brief Slab test of one ray against the four child boxes of a node.
+     * @param t_near Receives the entry distance of each child.
+     * @return A bit mask of the children that are hit within [t_min, t_max].
+     */
+    static inline int hit_children(const WideBVHNode& node, const RayPacket4& ray, float t_min, float t_max, float t_near[4]) {
+#if defined(__SSE2__)
+        __m128 t0 = _mm_set1_ps(t_min);
+        __m128 t1 = _mm_set1_ps(t_max);
+        for (int a = 0; a < 3; ++a) {
+            const __m128 inv = _mm_set1_ps(ray.inv_dir[a]);
+            __m128 near_plane = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[ray.near_side[a]][a]),
+                                                      _mm_set1_ps(ray.near_origin[a])), inv);
+            __m128 far_plane = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[1 - ray.near_side[a]][a]),
+                                                     _mm_set1_ps(ray.far_origin[a])), inv);
+            far_plane = _mm_mul_ps(far_plane, _mm_set1_ps(far_widening));
+            t0 = _mm_max_ps(near_plane, t0);
+            t1 = _mm_min_ps(far_plane, t1);
+        }
+        _mm_storeu_ps(t_near, t0);
+        return _mm_movemask_ps(_mm_cmple_ps(t0, t1));
+#else
+        int mask = 0;
+        for (int c = 0; c < 4; ++c) {
+            float t0 = t_min, t1 = t_max;
+            for (int a = 0; a < 3; ++a) {
+                float near_plane = (node.bounds[ray.near_side[a]][a][c] - ray.near_origin[a]) * ray.inv_dir[a];
+                float far_plane = (node.bounds[1 - ray.near_side[a]][a][c] - ray.far_origin[a]) * ray.inv_dir[a] * far_widening;
+                t0 = near_plane > t0 ? near_plane : t0;
+                t1 = far_plane < t1 ? far_plane : t1;
+            }
+            t_near[c] = t0;
+            if (t0 <= t1) mask |= 1 << c;
+        }
+        return mask;
+#endif
+    }
+
+    BVH binary;                     // Binary tree: owns the primitives and provides the leaves
+    std::vector<WideBVHNode> nodes; // Wide nodes, root first
+};
@@ -0,0 +1,134 @@
+#pragma once
+#include <string_view>
+#include <vector>
+
+/**
+ * @struct XMLAttribute
+ * @brief One `name="value"` pair of a tag, as views into the parsed text.
+ */
+struct XMLAttribute {
+    std::string_view name;
+    std::string_view value;
+};
+
+/**
+ * @struct XMLTag
+ * @brief A tag returned by XMLTokenizer; its views point into the tokenized text.
+ */
+struct XMLTag {
+    enum Kind { Start, End, SelfClosing };
+
+    Kind kind = Start;
+    std::string_view name;
+    std::vector<XMLAttribute> attributes; // Reused from tag to tag, so it stops allocating after the first tags
+
+    // Value of an attribute, or an empty view if the tag does not have it
+    std::string_view attribute(std::string_view attribute_name) const {
+        for (const XMLAttribute& attr : attributes) {
+            if (attr.name == attribute_name) return attr.value;
+        }
+        return {};
+    }
+};
+
+/**
+ * @class XMLTokenizer
+ * @brief Single-pass tokenizer for the subset of XML used by the scene files.
+ *
+ * Walks the text once, from left to right, and returns its tags one by one
+ * (start, end or self-closing) with their attributes. Nothing is copied: tag
+ * names, attribute names and values are string_views into the text, which
+ * must outlive the tags. Text between tags, comments (`<!-- ... -->`),
+ * processing instructions (`<?...?>`) and declarations (`<!...>`) are
+ * skipped as they are met, so the cost stays linear in the size of the text
+ * however many comments it holds.
+ *
+ * Like the regex-based parser it replaces, the tokenizer is lenient: text
+ * that does not form an attribute is ignored, and an unterminated tag or
+ * comment ends the document.
+ */
+class XMLTokenizer {
+public:
+    explicit XMLTokenizer(std::string_view text) : text(text) {}
+
+    /**
+     * @brief Reads the next tag.
+     * @param tag Receives the tag; its attribute vector is reused.
+     * @return false at the end of the text.
+     */
+    bool next(XMLTag& tag) {
+        while (true) {
+            size_t open = text.find('<', pos);
+            if (open == std::string_view::npos) return finish();
+            if (text.compare(open + 1, 3, "!--") == 0) {
+                size_t comment_end = text.find("-->", open + 4);
+                if (comment_end == std::string_view::npos) return finish();
+                pos = comment_end + 3;
+                continue;
+            }
+            size_t close = text.find('>', open + 1);
+            if (close == std::string_view::npos) return finish();
+            pos = close + 1;
+
+            std::string_view content = text.substr(open + 1, close - open - 1);
+            if (content.empty() || content[0] == '?' || content[0] == '!') continue;
+
+            tag.attributes.clear();
+            tag.kind = XMLTag::Start;
+            if (content[0] == '/') {
+                tag.kind = XMLTag::End;
+                content.remove_prefix(1);
+            } else if (content.back() == '/') {
+                tag.kind = XMLTag::SelfClosing;
+                content.remove_suffix(1);
+            }
+
+            size_t name_end = 0;
+            while (name_end < content.size() && !is_space(content[name_end])) ++name_end;
+            tag.name = content.substr(0, name_end);
+            if (tag.kind != XMLTag::End) read_attributes(content.substr(name_end), tag);
+            return true;
+        }
+    }
+
+private:
+    static bool is_space(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+    static bool is_name_char(char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+    }
+
+    bool finish() {
+        pos = text.size();
+        return false;
+    }
+
+    // Reads the name="value" (or name='value') pairs of a tag, skipping anything else
+    static void read_attributes(std::string_view s, XMLTag& tag) {
+        size_t i = 0;
+        const size_t n = s.size();
+        while (i < n) {
+            if (!is_name_char(s[i])) {
+                ++i;
+                continue;
+            }
+            size_t name_start = i;
+            while (i < n && is_name_char(s[i])) ++i;
+            std::string_view name = s.substr(name_start, i - name_start);
+
+            size_t j = i;
+            while (j < n && is_space(s[j])) ++j;
+            if (j >= n || s[j] != '=') continue;
+            ++j;
+            while (j < n && is_space(s[j])) ++j;
+            if (j >= n || (s[j] != '"' && s[j] != '\'')) continue;
+            char quote = s[j];
+            size_t value_end = s.find(quote, j + 1);
+            if (value_end == std::string_view::npos) return;
+            tag.attributes.push_back({name, s.substr(j + 1, value_end - j - 1)});
+            i = value_end + 1;
+        }
+    }
+
+    std::string_view text;
+    size_t pos = 0;
+};
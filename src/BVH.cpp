@@ -0,0 +1,385 @@
+#include <algorithm>
+#include <cmath>
+#include "BVH.hpp"
+
+namespace {
+    constexpr int sah_bins = 12;           // Number of candidate split buckets per axis
+    constexpr double traversal_cost = 1.0; // Cost of visiting a node, relative to one primitive test
+    constexpr int max_sah_depth = 32;      // Below this depth, fall back to median splits to bound the tree depth
+
+    struct SAHBin {
+        AABB box;
+        int count = 0;
+    };
+
+    // Bucket of a centroid along an axis of the centroid bounds
+    int bin_index(const Point3& centroid, const AABB& centroid_bounds, int axis) {
+        double extent = centroid_bounds.maximum[axis] - centroid_bounds.minimum[axis];
+        int b = static_cast<int>(sah_bins * (centroid[axis] - centroid_bounds.minimum[axis]) / extent);
+        return std::clamp(b, 0, sah_bins - 1);
+    }
+
+    // Round a double bound to the nearest float towards -inf / +inf
+    float round_down(double x) {
+        float f = static_cast<float>(x);
+        return f > x ? std::nextafter(f, -INFINITY) : f;
+    }
+    float round_up(double x) {
+        float f = static_cast<float>(x);
+        return f < x ? std::nextafter(f, INFINITY) : f;
+    }
+}
+
+BVH::BVH(const Scene& scene) {
+    std::vector<BuildPrimitive> primitives;
+    for (const auto& object : scene.objects) {
+        collect_primitives(object, primitives);
+    }
+
+    num_primitives = primitives.size();
+    if (!primitives.empty()) {
+        nodes.reserve(2 * primitives.size());
+        build(primitives, 0, primitives.size(), 0);
+    }
+}
+
+// Recursively flatten nested Scenes (e.g. Parallelepiped) into individual primitives
+void BVH::collect_primitives(const shared_ptr<SceneBaseObject>& object,
+                             std::vector<BuildPrimitive>& primitives) {
+    if (auto group = std::dynamic_pointer_cast<Scene>(object)) {
+        for (const auto& child : group->objects) {
+            collect_primitives(child, primitives);
+        }
+        return;
+    }
+
+    AABB box;
+    if (!object->bounding_box(box)) {
+        unbounded.push_back(object);
+        return;
+    }
+
+    PrimitiveKind kind = GenericPrimitive;
+    if (std::dynamic_pointer_cast<Sphere>(object)) kind = SpherePrimitive;
+    else if (std::dynamic_pointer_cast<Parallelogram>(object)) kind = ParallelogramPrimitive;
+    primitives.push_back({object, kind, box, box.centroid()});
+}
+
+// Append a node with the given bounds (rounded outwards to float) and return its index
+uint32_t BVH::add_node(const AABB& bounds) {
+    LinearBVHNode node{};
+    for (int a = 0; a < 3; ++a) {
+        node.bounds_min[a] = round_down(bounds.minimum[a]);
+        node.bounds_max[a] = round_up(bounds.maximum[a]);
+    }
+    nodes.push_back(node);
+    return static_cast<uint32_t>(nodes.size() - 1);
+}
+
+uint32_t BVH::make_leaf(std::vector<BuildPrimitive>& primitives, size_t start, size_t end, const AABB& bounds) {
+    // A leaf only holds one kind of primitive: split mixed ranges by kind
+    std::sort(primitives.begin() + start, primitives.begin() + end,
+        [](const BuildPrimitive& a, const BuildPrimitive& b) { return a.kind < b.kind; });
+    if (primitives[start].kind != primitives[end - 1].kind) {
+        size_t mid = start + 1;
+        while (primitives[mid].kind == primitives[start].kind) ++mid;
+
+        AABB left_bounds, right_bounds;
+        for (size_t i = start; i < mid; ++i) left_bounds.expand(primitives[i].box);
+        for (size_t i = mid; i < end; ++i) right_bounds.expand(primitives[i].box);
+
+        uint32_t index = add_node(bounds);
+        make_leaf(primitives, start, mid, left_bounds);
+        uint32_t second = make_leaf(primitives, mid, end, right_bounds);
+        nodes[index].second_child_offset = second;
+        return index;
+    }
+
+    uint32_t index = add_node(bounds);
+    LinearBVHNode& node = nodes[index];
+    node.kind = primitives[start].kind;
+    node.primitive_count = static_cast<uint16_t>(end - start);
+
+    switch (node.kind) {
+    case SpherePrimitive:
+        node.primitives_offset = static_cast<uint32_t>(spheres.size());
+        for (size_t i = start; i < end; ++i)
+            spheres.add(*std::static_pointer_cast<Sphere>(primitives[i].object));
+        spheres.pad();
+        break;
+    case ParallelogramPrimitive:
+        node.primitives_offset = static_cast<uint32_t>(parallelograms.size());
+        for (size_t i = start; i < end; ++i)
+            parallelograms.push_back(*std::static_pointer_cast<Parallelogram>(primitives[i].object));
+        break;
+    default:
+        node.primitives_offset = static_cast<uint32_t>(generics.size());
+        for (size_t i = start; i < end; ++i)
+            generics.push_back(primitives[i].object);
+        break;
+    }
+    return index;
+}
+
+uint32_t BVH::build(std::vector<BuildPrimitive>& primitives, size_t start, size_t end, int depth) {
+    size_t count = end - start;
+
+    // 1. Bounds of the primitives and of their centroids
+    AABB bounds, centroid_bounds;
+    size_t sphere_count = 0;
+    for (size_t i = start; i < end; ++i) {
+        bounds.expand(primitives[i].box);
+        centroid_bounds.expand(primitives[i].centroid);
+        if (primitives[i].kind == SpherePrimitive) ++sphere_count;
+    }
+
+    // Spheres are intersected lane_width at a time, so a sphere-only leaf costs
+    // one test per SIMD batch rather than one per sphere, and may hold two batches
+    const bool sphere_leaf = sphere_count == count;
+    const size_t leaf_limit = sphere_leaf ? std::max<size_t>(max_leaf_size, 2 * SphereSoA::lane_width) : max_leaf_size;
+    const double leaf_cost = sphere_leaf
+        ? static_cast<double>((count + SphereSoA::lane_width - 1) / SphereSoA::lane_width)
+        : static_cast<double>(count);
+
+    if (count == 1) return make_leaf(primitives, start, end, bounds);
+
+    // 2. Evaluate the SAH cost of every bucket boundary on every axis
+    int best_axis = -1;
+    int best_split = -1;
+    double best_cost = infinity;
+
+    for (int axis = 0; axis < 3 && depth < max_sah_depth; ++axis) {
+        if (centroid_bounds.maximum[axis] - centroid_bounds.minimum[axis] <= 0) continue;
+
+        SAHBin bins[sah_bins];
+        for (size_t i = start; i < end; ++i) {
+            int b = bin_index(primitives[i].centroid, centroid_bounds, axis);
+            bins[b].count++;
+            bins[b].box.expand(primitives[i].box);
+        }
+
+        // Sweep from the right to get the area and count right of each boundary
+        double right_area[sah_bins - 1];
+        int right_count[sah_bins - 1];
+        AABB accumulated;
+        int accumulated_count = 0;
+        for (int i = sah_bins - 1; i > 0; --i) {
+            accumulated.expand(bins[i].box);
+            accumulated_count += bins[i].count;
+            right_area[i - 1] = accumulated.surface_area();
+            right_count[i - 1] = accumulated_count;
+        }
+
+        // Sweep from the left and combine
+        accumulated = AABB();
+        accumulated_count = 0;
+        for (int i = 0; i < sah_bins - 1; ++i) {
+            accumulated.expand(bins[i].box);
+            accumulated_count += bins[i].count;
+            if (accumulated_count == 0 || right_count[i] == 0) continue;
+
+            double cost = accumulated_count * accumulated.surface_area() + right_count[i] * right_area[i];
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_axis = axis;
+                best_split = i;
+            }
+        }
+    }
+
+    // 3. Make a leaf if splitting is not worth it
+    size_t mid;
+    int axis;
+    if (best_axis < 0) {
+        if (count <= leaf_limit) return make_leaf(primitives, start, end, bounds);
+
+        // No usable SAH split (coincident centroids, or tree too deep): median split
+        axis = centroid_bounds.longest_axis();
+        mid = start + count / 2;
+        std::nth_element(primitives.begin() + start, primitives.begin() + mid, primitives.begin() + end,
+            [axis](const BuildPrimitive& a, const BuildPrimitive& b) { return a.centroid[axis] < b.centroid[axis]; });
+    } else {
+        double split_cost = traversal_cost + best_cost / bounds.surface_area();
+        if (count <= leaf_limit && leaf_cost <= split_cost)
+            return make_leaf(primitives, start, end, bounds);
+
+        // 4. Partition the primitives around the chosen bucket boundary
+        axis = best_axis;
+        auto middle = std::partition(primitives.begin() + start, primitives.begin() + end,
+            [&](const BuildPrimitive& p) {
+                return bin_index(p.centroid, centroid_bounds, best_axis) <= best_split;
+            });
+        mid = middle - primitives.begin();
+    }
+
+    // 5. Emit the node, then its first child right after it (depth-first order)
+    uint32_t index = add_node(bounds);
+    nodes[index].axis = static_cast<uint8_t>(axis);
+    build(primitives, start, mid, depth + 1);
+    uint32_t second = build(primitives, mid, end, depth + 1);
+    nodes[index].second_child_offset = second;
+    return index;
+}
+
+bool BVH::hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const {
+    bool hit_anything = false;
+    double closest_so_far = t_max;
+
+    // Infinite objects are tested linearly
+    for (const auto& object : unbounded) {
+        if (object->hit(r, t_min, closest_so_far, rec)) {
+            hit_anything = true;
+            closest_so_far = rec.t;
+        }
+    }
+
+    if (nodes.empty()) return hit_anything;
+
+    const Point3 origin = r.origin();
+    const Vec3 dir = r.direction();
+    const Vec3 inv_dir(1.0 / dir[0], 1.0 / dir[1], 1.0 / dir[2]);
+    const bool dir_is_neg[3] = { inv_dir[0] < 0, inv_dir[1] < 0, inv_dir[2] < 0 };
+
+    // Iterative traversal: near child first, far child pushed on a fixed-size stack
+    uint32_t to_visit[stack_size];
+    int to_visit_offset = 0;
+    uint32_t current = 0;
+
+    while (true) {
+        const LinearBVHNode& node = nodes[current];
+        if (node.hit(origin, inv_dir, t_min, closest_so_far)) {
+            if (node.primitive_count > 0) {
+                if (hit_leaf(node, r, t_min, closest_so_far, rec)) {
+                    hit_anything = true;
+                    closest_so_far = rec.t;
+                }
+                if (to_visit_offset == 0) break;
+                current = to_visit[--to_visit_offset];
+            } else if (dir_is_neg[node.axis]) {
+                to_visit[to_visit_offset++] = current + 1;
+                current = node.second_child_offset;
+            } else {
+                to_visit[to_visit_offset++] = node.second_child_offset;
+                current = current + 1;
+            }
+        } else {
+            if (to_visit_offset == 0) break;
+            current = to_visit[--to_visit_offset];
+        }
+    }
+
+    return hit_anything;
+}
+
+bool BVH::occluded(const Ray& r, double t_min, double t_max) const {
+    for (const auto& object : unbounded) {
+        if (object->occluded(r, t_min, t_max)) return true;
+    }
+
+    if (nodes.empty()) return false;
+
+    const Point3 origin = r.origin();
+    const Vec3 dir = r.direction();
+    const Vec3 inv_dir(1.0 / dir[0], 1.0 / dir[1], 1.0 / dir[2]);
+
+    // Any blocker will do, so children are visited in storage order and the range never shrinks
+    uint32_t to_visit[stack_size];
+    int to_visit_offset = 0;
+    uint32_t current = 0;
+
+    while (true) {
+        const LinearBVHNode& node = nodes[current];
+        if (node.hit(origin, inv_dir, t_min, t_max)) {
+            if (node.primitive_count > 0) {
+                if (occluded_leaf(node, r, t_min, t_max)) return true;
+                if (to_visit_offset == 0) break;
+                current = to_visit[--to_visit_offset];
+            } else {
+                to_visit[to_visit_offset++] = node.second_child_offset;
+                current = current + 1;
+            }
+        } else {
+            if (to_visit_offset == 0) break;
+            current = to_visit[--to_visit_offset];
+        }
+    }
+
+    return false;
+}
+
+void BVH::hit_packet(const RayPacket& packet, double t_min, double t_max, HitRecord* recs, bool* hits) const {
+    double closest[RayPacket::max_size];
+    for (int k = 0; k < packet.size; ++k) {
+        hits[k] = false;
+        closest[k] = t_max;
+    }
+
+    // Infinite objects are tested linearly, ray by ray
+    for (const auto& object : unbounded) {
+        for (int k = 0; k < packet.size; ++k) {
+            if (object->hit(packet.ray(k), t_min, closest[k], recs[k])) {
+                hits[k] = true;
+                closest[k] = recs[k].t;
+            }
+        }
+    }
+
+    if (nodes.empty() || packet.size == 0) return;
+
+    // Largest distance any ray still accepts, for the packet's interval test
+    double packet_t_max = *std::max_element(closest, closest + packet.size);
+
+    // Stack of (node, first ray that may still hit it)
+    uint32_t to_visit[stack_size];
+    int to_visit_first[stack_size];
+    int to_visit_offset = 0;
+    uint32_t current = 0;
+    int first = 0;
+
+    while (true) {
+        const LinearBVHNode& node = nodes[current];
+
+        // The node is visited if the packet may hit it and some ray actually does
+        int first_hit = -1;
+        if (packet.may_hit(node.bounds_min, node.bounds_max, t_min, packet_t_max)) {
+            for (int k = first; k < packet.size; ++k) {
+                if (node.hit(packet.origin, packet.inv_dir[k], t_min, closest[k])) {
+                    first_hit = k;
+                    break;
+                }
+            }
+        }
+
+        if (first_hit >= 0 && node.primitive_count > 0) {
+            for (int k = first_hit; k < packet.size; ++k) {
+                if (k != first_hit && !node.hit(packet.origin, packet.inv_dir[k], t_min, closest[k])) continue;
+                if (hit_leaf(node, packet.ray(k), t_min, closest[k], recs[k])) {
+                    hits[k] = true;
+                    closest[k] = recs[k].t;
+                }
+            }
+            packet_t_max = *std::max_element(closest, closest + packet.size);
+        } else if (first_hit >= 0) {
+            // Near child first, judged by the first ray that hit the node
+            bool dir_is_neg = packet.inv_dir[first_hit][node.axis] < 0;
+            to_visit[to_visit_offset] = dir_is_neg ? current + 1 : node.second_child_offset;
+            to_visit_first[to_visit_offset++] = first_hit;
+            current = dir_is_neg ? node.second_child_offset : current + 1;
+            first = first_hit;
+            continue;
+        }
+
+        if (to_visit_offset == 0) break;
+        --to_visit_offset;
+        current = to_visit[to_visit_offset];
+        first = to_visit_first[to_visit_offset];
+    }
+}
+
+bool BVH::bounding_box(AABB& output_box) const {
+    if (!unbounded.empty() || nodes.empty()) return false;
+    const LinearBVHNode& root = nodes[0];
+    output_box = AABB(Point3(root.bounds_min[0], root.bounds_min[1], root.bounds_min[2]),
+                      Point3(root.bounds_max[0], root.bounds_max[1], root.bounds_max[2]));
+    return true;
+}
@@ -0,0 +1,286 @@
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <cmath>
+#include <set>
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+#include "BatchRenderer.hpp"
+#include "SavePng.hpp"
+#include "Scene.hpp"
+#include "Light.hpp"
+#include "Wavefront.hpp"
+#include "SceneXMLParser.hpp"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double seconds_between(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration<double>(to - from).count();
+}
+
+// Everything one scene of the batch needs, from its parsed file to its film.
+// The film and tile scheduler only exist while the job is being rendered, and everything
+// but the report is freed once its image is written, so memory does not grow with the batch.
+struct BatchJob {
+    BatchJobReport report;
+    std::unique_ptr<Scene> scene;
+    CameraConfig cam_config;
+    Color bg_color{0.05, 0.05, 0.1}; // Default background color
+    shared_ptr<SceneBaseObject> world;
+    std::unique_ptr<LightList> lights;
+    std::unique_ptr<Sampler> sampler;
+    std::unique_ptr<Film> film;
+    std::unique_ptr<TileScheduler> scheduler;
+    Viewport view;
+    std::atomic<int> completed_tiles{0};
+    std::once_flag setup;                // Allocates the film and scheduler when the first thread enters the job
+    std::atomic<int> users{1};           // Threads rendering the job, plus one until its last tile is finished
+    double start_time = 0.0;             // When the first thread entered the job, since the start of the render phase
+    double cost = 0.0;  // Estimated render cost, used to order the jobs
+};
+
+// Runs worker(thread_id) on num_threads threads, the calling thread being thread 0 (as render_tiles)
+template <typename Worker>
+void run_on_threads(int num_threads, const Worker& worker) {
+#ifdef _OPENMP
+    #pragma omp parallel num_threads(num_threads)
+    worker(omp_get_thread_num());
+#else
+    std::vector<std::thread> threads;
+    for (int t = 1; t < num_threads; ++t) threads.emplace_back(worker, t);
+    worker(0);
+    for (auto& thread : threads) thread.join();
+#endif
+}
+
+// Parses a scene and builds everything needed to render it; errors are stored in the report
+void prepare_job(BatchJob& job, const BatchSettings& settings) {
+    auto start = Clock::now();
+    SceneXMLParser parser;
+    SceneData parsed_data;
+    try {
+        parsed_data = parser.parseFile(job.report.scene_path);
+    } catch (const std::exception& e) {
+        job.report.error = std::string("scene parsing failed: ") + e.what();
+        return;
+    }
+    auto parsed = Clock::now();
+    job.report.parse = seconds_between(start, parsed);
+    job.report.objects = parsed_data.objects.size();
+
+    job.scene = std::make_unique<Scene>();
+    convertSceneDataToRenderScene(parsed_data, *job.scene, job.cam_config, job.bg_color);
+    job.view = make_viewport(job.cam_config, settings.image_width);
+    if (job.view.image_height <= 0) {
+        job.report.error = "image width " + std::to_string(settings.image_width) + " is too small for the camera aspect ratio";
+        return;
+    }
+    job.world = build_accelerator(*job.scene, settings.accel);
+    job.lights = std::make_unique<LightList>(*job.scene);
+    job.sampler = make_sampler(settings.sampler, settings.samples_per_pixel);
+    job.report.build = seconds_between(parsed, Clock::now());
+    job.report.image_width = settings.image_width;
+    job.report.image_height = job.view.image_height;
+
+    // A ray query costs about log(objects) node visits
+    double pixels = static_cast<double>(settings.image_width) * job.view.image_height;
+    job.cost = pixels * settings.samples_per_pixel * std::log2(2.0 + static_cast<double>(job.report.objects));
+}
+
+// Takes a reference on a job that is still being rendered; false once it has been freed
+bool acquire_job(BatchJob& job) {
+    int users = job.users.load(std::memory_order_acquire);
+    while (users > 0) {
+        if (job.users.compare_exchange_weak(users, users + 1, std::memory_order_acq_rel)) return true;
+    }
+    return false;
+}
+
+// Frees everything a job holds but its report (busy time read from the scheduler first)
+void free_job(BatchJob& job) {
+    if (job.scheduler) {
+        for (double seconds : job.scheduler->tile_times()) job.report.busy += seconds;
+    }
+    job.film.reset();
+    job.scheduler.reset();
+    job.world.reset();
+    job.lights.reset();
+    job.sampler.reset();
+    job.scene.reset();
+}
+
+// Drops a reference on a job; the last one frees it
+void release_job(BatchJob& job) {
+    if (job.users.fetch_sub(1, std::memory_order_acq_rel) == 1) free_job(job);
+}
+
+// Resolves the film of a finished job and writes its PNG
+void encode_job(BatchJob& job) {
+    auto start = Clock::now();
+    const int width = job.report.image_width, height = job.report.image_height;
+    PPMImage image{width, height, 255, std::vector<unsigned char>(static_cast<size_t>(width) * height * 3)};
+    job.film->write_rgb(image.pixels.data());
+    try {
+        write_png(image, job.report.output_path);
+    } catch (const std::exception& e) {
+        job.report.error = e.what();
+    }
+    job.report.encode = seconds_between(start, Clock::now());
+}
+
+// Output file of each scene: <output_dir>/<scene name>.png, numbered if two scenes share a name
+std::vector<std::string> output_paths(const std::vector<std::string>& scenes, const std::string& output_dir) {
+    std::vector<std::string> paths;
+    std::set<std::string> used;
+    for (size_t i = 0; i < scenes.size(); ++i) {
+        std::string stem = fs::path(scenes[i]).stem().string();
+        std::string name = stem + ".png";
+        for (int n = 2; used.count(name); ++n) name = stem + "_" + std::to_string(n) + ".png";
+        used.insert(name);
+        paths.push_back((fs::path(output_dir) / name).string());
+    }
+    return paths;
+}
+
+} // namespace
+
+std::vector<std::string> collect_batch_scenes(const std::string& source) {
+    std::vector<std::string> scenes;
+    std::error_code ec;
+    if (fs::is_directory(source, ec)) {
+        for (const auto& entry : fs::directory_iterator(source, ec)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".xml")
+                scenes.push_back(entry.path().string());
+        }
+        if (ec) throw std::runtime_error("Cannot list directory " + source + ": " + ec.message());
+        std::sort(scenes.begin(), scenes.end());
+        return scenes;
+    }
+
+    // Manifest: one scene per line, relative to the manifest's directory
+    std::ifstream manifest(source);
+    if (!manifest) throw std::runtime_error("Cannot open scene directory or manifest: " + source);
+    fs::path base = fs::path(source).parent_path();
+    std::string line;
+    while (std::getline(manifest, line)) {
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') continue;
+        size_t last = line.find_last_not_of(" \t\r");
+        fs::path scene = line.substr(first, last - first + 1);
+        scenes.push_back(scene.is_absolute() ? scene.string() : (base / scene).string());
+    }
+    return scenes;
+}
+
+std::vector<BatchJobReport> render_batch(const std::vector<std::string>& scenes,
+                                         const BatchSettings& settings, std::ostream& log) {
+    const int num_threads = std::max(1, settings.num_threads);
+    std::vector<std::string> outputs = output_paths(scenes, settings.output_dir);
+    std::vector<std::unique_ptr<BatchJob>> jobs;
+    for (size_t i = 0; i < scenes.size(); ++i) {
+        jobs.push_back(std::make_unique<BatchJob>());
+        jobs.back()->report.scene_path = scenes[i];
+        jobs.back()->report.output_path = outputs[i];
+    }
+    std::mutex log_mutex;
+
+    // 1. Parse and build every scene up front, one scene per thread at a time
+    std::atomic<size_t> next_scene{0};
+    run_on_threads(std::min<int>(num_threads, std::max<size_t>(jobs.size(), 1)), [&](int) {
+        for (size_t i; (i = next_scene.fetch_add(1)) < jobs.size();) {
+            prepare_job(*jobs[i], settings);
+            if (!jobs[i]->report.error.empty()) {
+                free_job(*jobs[i]);
+                std::lock_guard<std::mutex> lock(log_mutex);
+                log << "Skipping " << jobs[i]->report.scene_path << ": " << jobs[i]->report.error << "\n";
+            }
+        }
+    });
+
+    // 2. Render the jobs, most expensive first, over the shared threads
+    std::vector<BatchJob*> queue;
+    for (auto& job : jobs) {
+        if (job->report.error.empty()) queue.push_back(job.get());
+    }
+    std::stable_sort(queue.begin(), queue.end(), [](const BatchJob* a, const BatchJob* b) { return a->cost > b->cost; });
+
+    const auto render_start = Clock::now();
+    auto render_blocks = settings.engine == RenderEngine::Wavefront ? render_blocks_wavefront : render_blocks_round_robin;
+    run_on_threads(num_threads, [&](int thread_id) {
+        for (BatchJob* job : queue) {
+            if (!acquire_job(*job)) continue; // Finished and freed
+            std::call_once(job->setup, [&] {
+                job->start_time = seconds_between(render_start, Clock::now());
+                job->film = std::make_unique<Film>(job->report.image_width, job->report.image_height);
+                job->scheduler = std::make_unique<TileScheduler>(job->report.image_width, job->report.image_height, num_threads);
+            });
+
+            // The thread finishing the last tile ends the job; the others have already moved on.
+            // The last thread to leave the job frees it.
+            ProgressCallback on_tile = [&, job](const Tile&, int finished, int total) {
+                if (finished != total) return;
+                job->report.start = job->start_time;
+                job->report.render = seconds_between(render_start, Clock::now()) - job->report.start;
+                encode_job(*job);
+                {
+                    std::lock_guard<std::mutex> lock(log_mutex);
+                    if (job->report.error.empty()) log << "Rendered " << job->report.scene_path << " -> " << job->report.output_path << "\n";
+                    else log << "Failed " << job->report.scene_path << ": " << job->report.error << "\n";
+                }
+                release_job(*job); // The job's own reference: no thread enters it any more
+            };
+            render_blocks(thread_id, *job->scheduler, *job->world, job->scene->materials, *job->lights,
+                          job->view.origin, job->view.horizontal, job->view.vertical,
+                          job->view.lower_left_corner,
+                          job->report.image_width, job->report.image_height,
+                          settings.samples_per_pixel, settings.max_depth, settings.rr_min_depth,
+                          job->bg_color, *job->film, job->completed_tiles, on_tile,
+                          nullptr, nullptr, job->sampler.get());
+            release_job(*job);
+        }
+    });
+
+    std::vector<BatchJobReport> reports;
+    for (auto& job : jobs) reports.push_back(std::move(job->report));
+    return reports;
+}
+
+void print_batch_summary(const std::vector<BatchJobReport>& reports, const BatchSettings& settings,
+                         double wall_seconds, std::ostream& out) {
+    int failed = 0;
+    double busy = 0.0;
+    for (const BatchJobReport& report : reports) {
+        out << "scene=" << report.scene_path;
+        if (!report.error.empty()) {
+            ++failed;
+            out << " status=failed" << std::endl;
+            continue;
+        }
+        busy += report.busy;
+        out << " output=" << report.output_path
+            << " objects=" << report.objects
+            << " width=" << report.image_width << " height=" << report.image_height
+            << " parse=" << report.parse << " build=" << report.build
+            << " start=" << report.start << " render=" << report.render
+            << " busy=" << report.busy << " encode=" << report.encode << std::endl;
+    }
+    // Share of the threads' time spent rendering tiles over the whole batch
+    double utilisation = wall_seconds > 0.0 ? busy / (wall_seconds * std::max(1, settings.num_threads)) : 0.0;
+    out << "batch jobs=" << reports.size() << " failed=" << failed
+        << " spp=" << settings.samples_per_pixel << " depth=" << settings.max_depth
+        << " threads=" << settings.num_threads
+        << " busy=" << busy << " utilisation=" << utilisation
+        << " total=" << wall_seconds << std::endl;
+}
@@ -67,13 +67,16 @@ void render_cb(Fl_Widget*, void*) {
 }
 
 /**
- * @brief 将渲染结果保存为PNG（基于libpng实现）
+ * @brief 取消渲染（默认实现：没有后台渲染可取消，main.cpp会重新绑定）
  */
-bool save_render_to_png(const std::string& save_path) {
-    if (!app_state.is_rendered || !app_state.render_buffer) {
-        return false;
-    }
+void cancel_cb(Fl_Widget*, void*) {
+    set_status("Nothing to cancel", FL_YELLOW);
+}
 
+/**
+ * @brief 将RGB图像（每像素3字节）保存为PNG（基于libpng实现）
+ */
+static bool write_rgb_png(const std::string& save_path, const unsigned char* buf, int width, int height) {
     FILE* fp = fopen(save_path.c_str(), "wb");
     if (!fp) return false;
 
@@ -87,15 +90,14 @@ bool save_render_to_png(const std::string& save_path) {
 
     // 设置PNG输出
     png_init_io(png_ptr, fp);
-    png_set_IHDR(png_ptr, info_ptr, app_state.buffer_width, app_state.buffer_height,
+    png_set_IHDR(png_ptr, info_ptr, width, height,
                  8, PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE,
                  PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
     png_write_info(png_ptr, info_ptr);
 
     // 写入像素数据（按行写入）
-    unsigned char* buf = (unsigned char*)app_state.render_buffer;
-    for (int y = 0; y < app_state.buffer_height; y++) {
-        png_write_row(png_ptr, buf + y * app_state.buffer_width * 3);
+    for (int y = 0; y < height; y++) {
+        png_write_row(png_ptr, buf + y * width * 3);
     }
 
     // 清理PNG资源
@@ -105,6 +107,17 @@ bool save_render_to_png(const std::string& save_path) {
     return true;
 }
 
+/**
+ * @brief 将渲染结果保存为PNG
+ */
+bool save_render_to_png(const std::string& save_path) {
+    if (!app_state.is_rendered || !app_state.render_buffer) {
+        return false;
+    }
+    return write_rgb_png(save_path, (const unsigned char*)app_state.render_buffer,
+                         app_state.buffer_width, app_state.buffer_height);
+}
+
 /**
  * @brief 保存PNG回调（选择保存路径+执行保存）
  */
@@ -129,10 +142,18 @@ void save_png_cb(Fl_Widget*, void*) {
         }
 
         // 执行保存
-        if (save_render_to_png(save_path)) {
-            set_status("PNG Saved Successfully", FL_DARK_GREEN);
-        } else {
+        if (!save_render_to_png(save_path)) {
             set_status("Save failure", FL_DARK_GREEN);
+        } else if (!app_state.spp_heatmap.empty()) {
+            // 自适应渲染：采样热力图保存在图片旁边（render.png -> render_spp.png）
+            std::string heatmap_path = save_path.substr(0, save_path.rfind(".png")) + "_spp.png";
+            if (write_rgb_png(heatmap_path, app_state.spp_heatmap.data(), app_state.buffer_width, app_state.buffer_height)) {
+                set_status("PNG and spp heatmap (" + heatmap_path + ") Saved Successfully", FL_DARK_GREEN);
+            } else {
+                set_status("PNG saved, spp heatmap save failure", FL_DARK_GREEN);
+            }
+        } else {
+            set_status("PNG Saved Successfully", FL_DARK_GREEN);
         }
     }
 }
@@ -158,13 +179,27 @@ Fl_Window* init_gui(int width = 900, int height = 700) {
     int sidebar_w = 200; // 左边栏宽度
 
     // ===== 新增：左侧场景列表 =====
-    Fl_Hold_Browser* browser = new Fl_Hold_Browser(margin, margin, sidebar_w, height - 180, "Scenes");
+    Fl_Hold_Browser* browser = new Fl_Hold_Browser(margin, margin, sidebar_w, height - 240, "Scenes");
     browser->color(fl_rgb_color(45, 45, 45));
     browser->textcolor(FL_WHITE);
     browser->has_scrollbar(Fl_Browser_::VERTICAL);
     browser->align(FL_ALIGN_TOP_LEFT);
     app_state.file_browser = browser;
 
+    // ===== 新增：渐进式渲染开关 (位于场景列表下方，默认开启) =====
+    Fl_Check_Button* progressive_check = new Fl_Check_Button(margin, height - 215, sidebar_w, 25, "Progressive preview");
+    progressive_check->labelcolor(FL_WHITE);
+    progressive_check->tooltip("Render in passes and refresh the whole image after each pass");
+    progressive_check->value(1);
+    app_state.progressive_check = progressive_check;
+
+    // ===== 新增：自适应采样开关 (默认关闭，保存图片时采样热力图写入 <名称>_spp.png) =====
+    Fl_Check_Button* adaptive_check = new Fl_Check_Button(margin, height - 190, sidebar_w, 25, "Adaptive sampling");
+    adaptive_check->labelcolor(FL_WHITE);
+    adaptive_check->tooltip("Spend the samples on noisy pixels; Save Image also writes the spp heatmap (<name>_spp.png)");
+    adaptive_check->value(0);
+    app_state.adaptive_check = adaptive_check;
+
     // ===== 修改：渲染结果显示区域 (坐标 X 增加 sidebar_w + spacing) =====
     int canvas_x = margin + sidebar_w + margin;
     int canvas_w = width - canvas_x - margin;
@@ -193,7 +228,7 @@ Fl_Window* init_gui(int width = 900, int height = 700) {
     int btn_h = 45;
     int btn_y = height - 70;
     int spacing = 15;
-    int btn_w = (width - 2 * margin - 2 * spacing) / 3;
+    int btn_w = (width - 2 * margin - 3 * spacing) / 4;
 
     // 选择文件按钮
     Fl_Button* select_btn = new Fl_Button(margin, btn_y, btn_w, btn_h, "@refresh  Refresh");
@@ -214,10 +249,21 @@ Fl_Window* init_gui(int width = 900, int height = 700) {
     save_btn->color(fl_rgb_color(40, 110, 40));
     save_btn->labelcolor(FL_WHITE);
 
+    // 取消按钮 (暗红色)
+    Fl_Button* cancel_btn = new Fl_Button(margin + 3 * (btn_w + spacing), btn_y, btn_w, btn_h, "@square  Cancel");
+    cancel_btn->box(FL_GTK_UP_BOX);
+    cancel_btn->color(fl_rgb_color(140, 40, 40));
+    cancel_btn->labelcolor(FL_WHITE);
+
     // 绑定回调
     select_btn->callback(select_file_cb);
     render_btn->callback(render_cb);
     save_btn->callback(save_png_cb);
+    cancel_btn->callback(cancel_cb);
+    app_state.refresh_button = select_btn;
+    app_state.render_button = render_btn;
+    app_state.save_button = save_btn;
+    app_state.cancel_button = cancel_btn;
 
     win->end();
     win->resizable(display_box); 
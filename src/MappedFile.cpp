@@ -0,0 +1,53 @@
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include "MappedFile.hpp"
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define RT_HAVE_MMAP 1
+#endif
+
+MappedFile::MappedFile(const std::string& path) {
+#ifdef RT_HAVE_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Failed to open " + path + ": " + std::strerror(errno));
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        int error = errno;
+        ::close(fd);
+        throw std::runtime_error("Failed to read the size of " + path + ": " + std::strerror(error));
+    }
+    length = static_cast<size_t>(info.st_size);
+    if (length > 0) { // mmap() rejects empty mappings; an empty file is an empty view
+        void* address = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address == MAP_FAILED) {
+            int error = errno;
+            ::close(fd);
+            throw std::runtime_error("Failed to map " + path + ": " + std::strerror(error));
+        }
+        ::madvise(address, length, MADV_SEQUENTIAL); // Only a hint: failure is harmless
+        data = static_cast<const char*>(address);
+        mapped = true;
+    }
+    ::close(fd); // The mapping keeps its own reference to the file
+#else
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) throw std::runtime_error("Failed to open " + path);
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    buffer = std::move(contents).str();
+    data = buffer.data();
+    length = buffer.size();
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifdef RT_HAVE_MMAP
+    if (mapped) ::munmap(const_cast<char*>(data), length);
+#endif
+}
@@ -0,0 +1,288 @@
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include "RenderUtils.hpp"
+#include "Wavefront.hpp"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Camera rays are traced in packets of packet_block x packet_block neighbouring pixels
+constexpr int packet_block = 8;
+static_assert(packet_block * packet_block <= RayPacket::max_size, "A block of pixels must fit in a RayPacket");
+
+/**
+ * @brief Calculate the final color seen by a specific ray (iterative path tracer)
+ *
+ * Instead of recursing once per bounce, the path is followed in a loop that
+ * carries the product of the attenuations so far (the path throughput).
+ * After `rr_min_depth` bounces, Russian roulette terminates the path with a
+ * probability that grows as the throughput gets darker; surviving paths are
+ * divided by their survival probability, so the estimate stays unbiased.
+ *
+ * At every diffuse hit the emissive spheres are also sampled explicitly
+ * (`sample_direct_light`). When the scattered ray of a diffuse bounce then
+ * hits one of those lights, its emission is weighted by the complementary
+ * MIS weight, so that the light is not counted twice.
+ *
+ * Each bounce reads its random numbers from its own block of sampler
+ * dimensions, at fixed offsets for each use. The work of a bounce is done by
+ * shade_hit (Integrator.hpp), which the wavefront engine shares.
+ *
+ * @param r The ray.
+ * @param world The scene.
+ * @param materials The material table the hit records refer to.
+ * @param lights The emissive spheres sampled for direct lighting.
+ * @param bg_color The background color if the ray hits nothing
+ * @param max_depth Maximum number of ray bounces
+ * @param rr_min_depth Number of bounces before Russian roulette may terminate the path
+ * @param sampler The sampler of the current pixel sample
+ * @return The final color of the pixel
+ */
+Color ray_color(const Ray& r, const SceneBaseObject& world, const MaterialTable& materials,
+                const LightList& lights, const Color& bg_color, int max_depth, int rr_min_depth,
+                Sampler& sampler) {
+    HitRecord rec;
+    bool hit = max_depth > 0 && world.hit(r, 0.001, infinity, rec);
+    return ray_color(r, hit, rec, world, materials, lights, bg_color, max_depth, rr_min_depth, sampler);
+}
+
+Color ray_color(const Ray& r, bool first_hit, const HitRecord& first_rec,
+                const SceneBaseObject& world, const MaterialTable& materials,
+                const LightList& lights, const Color& bg_color, int max_depth, int rr_min_depth,
+                Sampler& sampler) {
+    PathState path;
+    path.ray = r;
+    HitRecord rec = first_rec;
+    bool hit = first_hit;
+
+    while (path.depth < max_depth) {
+        // The first intersection was found by the caller
+        if (path.depth > 0) hit = world.hit(path.ray, 0.001, infinity, rec);
+
+        // Background color (if no objects are hit)
+        // To clearly see the effect of point light sources, we change the originally bright sky to [pure black] or [faint starlight]
+        if (!hit) {
+            path.radiance += path.throughput * bg_color;
+            break;
+        }
+
+        // Emission, direct light and scattering at the hit point; the shadow ray is traced right away
+        ShadowRay shadow;
+        bool alive = shade_hit(path, rec, materials, lights, rr_min_depth, sampler, shadow);
+        if (shadow.pending && !world.occluded(shadow.ray, 0.001, shadow.t_max))
+            path.radiance += shadow.contribution;
+        if (!alive)
+            break;
+    }
+
+    return path.radiance;
+}
+
+/**
+ * @brief Convert XML data to Scene structure, camera settings and background color
+ */
+void convertSceneDataToRenderScene(const SceneData& data, Scene& render_scene,
+                                   CameraConfig& cam_config, Color& bg_color) {
+    // Traverse all objects (including ground); their values were parsed and checked by the parser
+    for (const auto& xml_obj : data.objects) {
+        MaterialId mat;
+        const auto& mat_data = xml_obj.material;
+
+        // ========== Material (extend point light material) ==========
+        switch (mat_data.type) {
+        case MaterialType::Matte:
+            mat = render_scene.materials.add<Matte>(mat_data.color);
+            break;
+        case MaterialType::Metal:
+            mat = render_scene.materials.add<Metal>(mat_data.color, mat_data.fuzz);
+            break;
+        case MaterialType::Glass:
+            mat = render_scene.materials.add<Glass>(mat_data.ior);
+            break;
+        case MaterialType::Light:
+            mat = render_scene.materials.add<PointLight>(Color(mat_data.intensity, mat_data.intensity, mat_data.intensity));
+            break;
+        default:
+            // Unknown material type: fall back to a neutral grey matte
+            std::cerr << "Unknown material type '" << mat_data.type_name << "' for object " << xml_obj.id << ", using grey matte\n";
+            mat = render_scene.materials.add<Matte>(Color(0.5, 0.5, 0.5));
+            break;
+        }
+
+        // ========== Object (extend plane, parallelepiped) ==========
+        switch (xml_obj.type) {
+        case ObjectType::Sphere:
+            render_scene.add(std::make_shared<Sphere>(xml_obj.position, xml_obj.radius, mat));
+            break;
+        case ObjectType::Plane: // Ground
+            render_scene.add(std::make_shared<Plane>(xml_obj.position, xml_obj.normal, mat));
+            break;
+        case ObjectType::Parallelepiped:
+            render_scene.add(std::make_shared<Parallelepiped>(xml_obj.origin, xml_obj.u, xml_obj.v, xml_obj.w, mat));
+            break;
+        default: // Unknown object types are skipped
+            break;
+        }
+    }
+
+    // Camera parameters (override hard-coded values)
+    if (data.camera.defined) {
+        // Store to the camera configuration used by the caller to set up the viewport
+        cam_config.origin = data.camera.position;
+        cam_config.focal_length = data.camera.focal_length;
+        cam_config.viewport_height = data.camera.viewport_height;
+        cam_config.aspect_ratio = data.camera.aspect_ratio;
+    }
+
+    // Global settings (background color replaces the default value)
+    if (data.global_settings.has_background_color) {
+        bg_color = data.global_settings.background_color;
+    }
+}
+
+void render_blocks_round_robin(int thread_id,
+                               TileScheduler& scheduler,
+                               const SceneBaseObject& world,
+                               const MaterialTable& materials,
+                               const LightList& lights,
+                               const Point3& origin, const Vec3& horizontal, const Vec3& vertical,
+                               const Point3& lower_left_corner,
+                               int image_width, int image_height,
+                               int samples_per_pixel, int max_depth, int rr_min_depth,
+                               const Color& bg_color,
+                               Film& film,
+                               std::atomic<int>& completed_tiles,
+                               const ProgressCallback& progress,
+                               const std::atomic<bool>* cancel,
+                               const AdaptiveSampling* adaptive,
+                               const Sampler* sampler) {
+    const int total_tiles = static_cast<int>(scheduler.tile_count());
+    Tile tile;
+
+    // Samplers keep per-sample state: every thread works on its own copy
+    std::unique_ptr<Sampler> thread_sampler = sampler ? sampler->clone() : std::make_unique<IndependentSampler>();
+
+    while (scheduler.next(thread_id, tile)) {
+        auto tile_start = std::chrono::steady_clock::now();
+
+        // Blocks of packet_block x packet_block pixels: their camera rays are traced as packets
+        for (int by = tile.y0; by < tile.y1; by += packet_block) {
+            for (int bx = tile.x0; bx < tile.x1; bx += packet_block) {
+                if (cancel && cancel->load(std::memory_order_relaxed)) return;
+
+                // Pixels of the block still to sample, and their accumulated samples
+                int pixel_i[RayPacket::max_size], pixel_j[RayPacket::max_size];
+                int pixel_first[RayPacket::max_size], pixel_samples[RayPacket::max_size];
+                Color pixel_color[RayPacket::max_size];
+                double lum_sum[RayPacket::max_size], lum_sq_sum[RayPacket::max_size];
+                int pixel_count = 0, max_samples = 0;
+                for (int j = by; j < std::min(by + packet_block, tile.y1); ++j) {
+                    for (int i = bx; i < std::min(bx + packet_block, tile.x1); ++i) {
+                        int samples = samples_per_pixel;
+                        if (adaptive) {
+                            if (film.converged(i, j, *adaptive)) continue;
+                            samples = std::min(samples, adaptive->max_samples - film.samples(i, j));
+                        }
+                        pixel_i[pixel_count] = i;
+                        pixel_j[pixel_count] = j;
+                        pixel_first[pixel_count] = film.samples(i, j); // Passes continue the pixel's sequence
+                        pixel_samples[pixel_count] = samples;
+                        pixel_color[pixel_count] = Color(0,0,0);
+                        lum_sum[pixel_count] = lum_sq_sum[pixel_count] = 0.0;
+                        max_samples = std::max(max_samples, samples);
+                        ++pixel_count;
+                    }
+                }
+
+                // Sample s of every pixel: one packet of camera rays, then each path on its own
+                RayPacket packet;
+                HitRecord recs[RayPacket::max_size];
+                bool hits[RayPacket::max_size];
+                int packet_pixel[RayPacket::max_size];
+                for (int s = 0; s < max_samples; ++s) {
+                    packet.reset(origin);
+                    for (int p = 0; p < pixel_count; ++p) {
+                        if (s >= pixel_samples[p]) continue;
+                        thread_sampler->start_pixel_sample(pixel_i[p], pixel_j[p], pixel_first[p] + s);
+                        double du, dv;
+                        thread_sampler->get_2d(du, dv);
+                        int original_j = image_height - 1 - pixel_j[p]; // Buffer rows go top-down, v goes bottom-up
+                        auto u = (pixel_i[p] + du) / (image_width-1);
+                        auto v = (original_j + dv) / (image_height-1);
+                        packet_pixel[packet.size] = p;
+                        packet.add(lower_left_corner + u*horizontal + v*vertical - origin);
+                    }
+                    packet.finish();
+                    if (max_depth > 0) {
+                        world.hit_packet(packet, 0.001, infinity, recs, hits);
+                    } else {
+                        std::fill(hits, hits + packet.size, false);
+                    }
+
+                    for (int k = 0; k < packet.size; ++k) {
+                        int p = packet_pixel[k];
+                        thread_sampler->start_pixel_sample(pixel_i[p], pixel_j[p], pixel_first[p] + s);
+                        Color sample = ray_color(packet.ray(k), hits[k], recs[k], world, materials, lights,
+                                                 bg_color, max_depth, rr_min_depth, *thread_sampler);
+                        double lum = Film::luminance(sample);
+                        pixel_color[p] += sample;
+                        lum_sum[p] += lum;
+                        lum_sq_sum[p] += lum * lum;
+                    }
+                }
+
+                for (int p = 0; p < pixel_count; ++p)
+                    film.add(pixel_i[p], pixel_j[p], pixel_color[p], lum_sum[p], lum_sq_sum[p], pixel_samples[p]);
+            }
+        }
+
+        std::chrono::duration<double> tile_time = std::chrono::steady_clock::now() - tile_start;
+        scheduler.record(tile, thread_id, tile_time.count());
+
+        // Release this tile's film writes; the thread that counts the last tile sees all of them
+        int finished = completed_tiles.fetch_add(1, std::memory_order_acq_rel) + 1;
+        if (progress) progress(tile, finished, total_tiles);
+    }
+}
+
+void render_tiles(int num_threads,
+                  TileScheduler& scheduler,
+                  const SceneBaseObject& world,
+                  const MaterialTable& materials,
+                  const LightList& lights,
+                  const Point3& origin, const Vec3& horizontal, const Vec3& vertical,
+                  const Point3& lower_left_corner,
+                  int image_width, int image_height,
+                  int samples_per_pixel, int max_depth, int rr_min_depth,
+                  const Color& bg_color,
+                  Film& film,
+                  std::atomic<int>& completed_tiles,
+                  const ProgressCallback& progress,
+                  const std::atomic<bool>* cancel,
+                  const AdaptiveSampling* adaptive,
+                  const Sampler* sampler,
+                  RenderEngine engine) {
+    num_threads = std::max(1, num_threads);
+    auto render_blocks = engine == RenderEngine::Wavefront ? render_blocks_wavefront : render_blocks_round_robin;
+    auto worker = [&](int thread_id) {
+        render_blocks(thread_id, scheduler, world, materials, lights,
+                      origin, horizontal, vertical, lower_left_corner,
+                      image_width, image_height,
+                      samples_per_pixel, max_depth, rr_min_depth,
+                      bg_color, film, completed_tiles, progress, cancel, adaptive, sampler);
+    };
+
+#ifdef _OPENMP
+    // The master thread of the region is the calling thread, i.e. thread 0
+    #pragma omp parallel num_threads(num_threads)
+    worker(omp_get_thread_num());
+#else
+    // Thread 0 runs on the calling thread, the others on std::threads
+    std::vector<std::thread> threads;
+    for (int t = 1; t < num_threads; ++t) threads.emplace_back(worker, t);
+    worker(0);
+    for (auto& thread : threads) thread.join();
+#endif
+}
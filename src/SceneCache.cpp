@@ -0,0 +1,438 @@
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+#include <chrono>
+#include <filesystem>
+#include <type_traits>
+#include "SceneCache.hpp"
+#include "MappedFile.hpp"
+#include "SceneXMLParser.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr char cache_magic[8] = {'R', 'T', 'S', 'C', 'E', 'N', 'E', '\0'};
+constexpr uint32_t cache_version = 1;    // Bump whenever the layout below or the BVH builder changes
+constexpr uint32_t byte_order = 0x01020304;
+
+// Fixed-size header at the start of the file; the arrays follow in the order of the counts
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;         // Written natively: a cache from a machine of the other endianness is rejected
+    uint32_t sphere_lane_width;  // SphereSoA padding the tree was built with
+    uint32_t node_size;          // sizeof(LinearBVHNode)
+    uint64_t source_size;        // Size of the XML file
+    int64_t source_mtime;        // Modification time of the XML file (ns)
+    uint64_t source_hash;        // Hash of the XML content
+    uint64_t object_count;
+    uint64_t primitive_count;    // BVH::num_primitives
+    uint64_t material_count, light_count, node_count, sphere_count, parallelogram_count, plane_count;
+    double camera[6];            // Origin, focal length, viewport height, aspect ratio
+    double background[3];
+};
+
+enum CachedMaterialType : uint32_t { CachedMatte, CachedMetal, CachedGlass, CachedLight };
+
+struct CachedMaterial {
+    uint32_t type;     // CachedMaterialType
+    uint32_t padding;
+    double color[3];   // Albedo, or emitted color of a light
+    double parameter;  // Metal fuzz or glass index of refraction
+};
+
+struct CachedSphereLight {
+    double center[3];
+    double radius;
+    MaterialId mat_id;
+    uint32_t padding;
+};
+
+struct CachedParallelogram {
+    double q[3], u[3], v[3];
+    MaterialId mat_id;
+    uint32_t padding;
+};
+
+struct CachedPlane {
+    double point[3], normal[3];
+    MaterialId mat_id;
+    uint32_t padding;
+};
+
+static_assert(std::is_trivially_copyable_v<CacheHeader> && sizeof(CacheHeader) % 8 == 0);
+static_assert(std::is_trivially_copyable_v<LinearBVHNode>);
+
+// Size and modification time of a scene file (the hash is filled by the caller).
+// A file that cannot be stat'ed gets a zero stamp, and MappedFile reports why it cannot be read.
+SceneCache::SourceStamp stat_source(const std::string& path) {
+    SceneCache::SourceStamp stamp;
+    std::error_code ec;
+    uintmax_t size = fs::file_size(path, ec);
+    if (ec) return stamp;
+    fs::file_time_type mtime = fs::last_write_time(path, ec);
+    if (ec) return stamp;
+    stamp.size = size;
+    stamp.mtime = std::chrono::duration_cast<std::chrono::nanoseconds>(mtime.time_since_epoch()).count();
+    return stamp;
+}
+
+inline uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+// 64-bit hash of a byte string (MurmurHash3-style mixing, 8 bytes per step)
+uint64_t hash_bytes(std::string_view data) {
+    const uint64_t c1 = 0x87c37b91114253d5ULL, c2 = 0x4cf5ad432745937fULL;
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ data.size();
+    size_t i = 0;
+    for (; i + 8 <= data.size(); i += 8) {
+        uint64_t k;
+        std::memcpy(&k, data.data() + i, 8);
+        h ^= rotl(k * c1, 31) * c2;
+        h = rotl(h, 27) * 5 + 0x52dce729;
+    }
+    uint64_t tail = 0;
+    if (i < data.size()) std::memcpy(&tail, data.data() + i, data.size() - i);
+    h ^= rotl(tail * c1, 31) * c2;
+
+    // Final avalanche
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+uint64_t hash_file(const std::string& path) {
+    MappedFile file(path);
+    return hash_bytes(file.view());
+}
+
+// Records the new modification time of a scene file whose content still matches the cache,
+// so that the next load takes the size and time path instead of hashing the file again.
+// A cache that cannot be written (e.g. read-only directory) keeps its old time.
+void restamp(const std::string& cache_path, int64_t mtime) {
+    std::fstream file(cache_path, std::ios::in | std::ios::out | std::ios::binary);
+    if (!file) return;
+    file.seekp(offsetof(CacheHeader, source_mtime));
+    file.write(reinterpret_cast<const char*>(&mtime), sizeof(mtime));
+}
+
+// Writes an array, then zeros up to the next multiple of 8 bytes
+template <typename T>
+void write_array(std::ofstream& out, const T* data, size_t count) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    size_t bytes = count * sizeof(T);
+    if (bytes) out.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+    static const char zeros[8] = {};
+    out.write(zeros, static_cast<std::streamsize>((8 - bytes % 8) % 8));
+}
+
+// Reads the arrays of a mapped cache, checking that each one lies within the file
+class ArrayReader {
+public:
+    explicit ArrayReader(std::string_view data) : data(data) {}
+
+    template <typename T>
+    bool read(T* out, size_t count) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        size_t bytes = count * sizeof(T);
+        if (count > data.size() / sizeof(T) || data.size() - pos < bytes) return false;
+        if (bytes) std::memcpy(out, data.data() + pos, bytes);
+        pos += (bytes + 7) / 8 * 8;
+        pos = std::min(pos, data.size());
+        return true;
+    }
+
+    template <typename T>
+    bool read(std::vector<T>& out, size_t count) {
+        if (count > data.size() / sizeof(T)) return false;
+        out.resize(count);
+        return read(out.data(), count);
+    }
+
+    bool at_end() const { return pos == data.size(); }
+
+private:
+    std::string_view data;
+    size_t pos = 0;
+};
+
+// Checks that the nodes of a cached tree only reference nodes and primitives that exist:
+// children after their parent and within the array, leaves within the array of their kind,
+// and no deeper than the traversal stack
+bool valid_tree(const std::vector<LinearBVHNode>& nodes, size_t sphere_count, size_t parallelogram_count) {
+    std::vector<int> depth(nodes.size(), 0);
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const LinearBVHNode& node = nodes[i];
+        if (depth[i] >= BVH::stack_size) return false;
+        if (node.primitive_count == 0) {
+            // Interior: the first child is the next node, the second one comes after it
+            if (node.axis > 2 || i + 1 >= nodes.size() || node.second_child_offset <= i + 1 ||
+                node.second_child_offset >= nodes.size())
+                return false;
+            depth[i + 1] = std::max(depth[i + 1], depth[i] + 1);
+            depth[node.second_child_offset] = std::max(depth[node.second_child_offset], depth[i] + 1);
+        } else {
+            uint64_t end = uint64_t(node.primitives_offset) + node.primitive_count;
+            if (node.kind == BVH::SpherePrimitive) {
+                // Sphere leaves are read up to the SIMD width
+                end = uint64_t(node.primitives_offset) +
+                      (node.primitive_count + SphereSoA::lane_width - 1) / SphereSoA::lane_width * SphereSoA::lane_width;
+                if (end > sphere_count) return false;
+            } else if (node.kind == BVH::ParallelogramPrimitive) {
+                if (end > parallelogram_count) return false;
+            } else {
+                return false; // Generic primitives are never cached
+            }
+        }
+    }
+    return true;
+}
+
+// Checks that every material id of a cached array refers to a cached material
+template <typename T, typename GetId>
+bool valid_materials(const std::vector<T>& items, size_t material_count, GetId get_id) {
+    for (const T& item : items) {
+        if (get_id(item) >= material_count) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+std::string SceneCache::path_for(const std::string& xml_path) {
+    return fs::path(xml_path).replace_extension(".rtscene").string();
+}
+
+CompiledScene SceneCache::load(const std::string& xml_path, AcceleratorType accel, std::ostream& log) {
+    CompiledScene scene;
+    BVH tree;
+    const std::string cache_path = path_for(xml_path);
+
+    if (read(cache_path, xml_path, scene, tree)) {
+        scene.from_cache = true;
+        log << "Scene loaded from cache: " << cache_path << ", total " << scene.object_count << " objects\n";
+    } else {
+        // Drop whatever a rejected cache had filled in
+        scene = CompiledScene();
+        tree = BVH();
+
+        // Parse and build from the XML, then save the result for the next load.
+        // The size and time are taken before the file is mapped: if it is saved in between, the
+        // cache records the old stamp, so the next load compares the hash of the parsed content.
+        // The file is hashed and parsed from the same mapping, so the hash matches what was parsed.
+        SourceStamp source = stat_source(xml_path);
+        MappedFile xml(xml_path);
+        source.hash = hash_bytes(xml.view());
+        SceneXMLParser parser;
+        SceneData parsed_data = parser.parseText(xml.view());
+        log << "Scene parsed successfully: " << xml_path << ", total " << parsed_data.objects.size() << " objects\n";
+
+        Scene render_scene;
+        convertSceneDataToRenderScene(parsed_data, render_scene, scene.cam_config, scene.bg_color);
+        tree = BVH(render_scene);
+        scene.lights = LightList(render_scene);
+        scene.materials = std::move(render_scene.materials);
+        scene.object_count = parsed_data.objects.size();
+        if (!write(cache_path, source, scene, tree)) log << "Could not write the scene cache " << cache_path << "\n";
+    }
+
+    if (accel == AcceleratorType::Wide4) scene.world = make_shared<WideBVH>(std::move(tree));
+    else scene.world = make_shared<BVH>(std::move(tree));
+    return scene;
+}
+
+bool SceneCache::read(const std::string& cache_path, const std::string& xml_path, CompiledScene& scene, BVH& tree) {
+    std::error_code ec;
+    if (!fs::exists(cache_path, ec)) return false;
+    try {
+        MappedFile file(cache_path);
+        std::string_view data = file.view();
+        CacheHeader header;
+        if (data.size() < sizeof(header)) return false;
+        std::memcpy(&header, data.data(), sizeof(header));
+        if (std::memcmp(header.magic, cache_magic, sizeof(cache_magic)) != 0 || header.version != cache_version ||
+            header.byte_order != byte_order || header.sphere_lane_width != SphereSoA::lane_width ||
+            header.node_size != sizeof(LinearBVHNode))
+            return false;
+
+        // Up to date: same size and time, or same content
+        SourceStamp source = stat_source(xml_path);
+        if (source.size != header.source_size) return false;
+        const bool touched = source.mtime != header.source_mtime; // Time changed: compare the content
+        if (touched && hash_file(xml_path) != header.source_hash) return false;
+
+        ArrayReader reader(data.substr(sizeof(header)));
+        std::vector<CachedMaterial> materials;
+        std::vector<CachedSphereLight> lights;
+        std::vector<CachedParallelogram> parallelograms;
+        std::vector<CachedPlane> planes;
+        SphereSoA& spheres = tree.spheres;
+        bool complete = reader.read(materials, header.material_count) &&
+                        reader.read(lights, header.light_count) &&
+                        reader.read(tree.nodes, header.node_count) &&
+                        reader.read(spheres.center_x, header.sphere_count) &&
+                        reader.read(spheres.center_y, header.sphere_count) &&
+                        reader.read(spheres.center_z, header.sphere_count) &&
+                        reader.read(spheres.radius, header.sphere_count) &&
+                        reader.read(spheres.materials, header.sphere_count) &&
+                        reader.read(parallelograms, header.parallelogram_count) &&
+                        reader.read(planes, header.plane_count) &&
+                        reader.at_end();
+        if (!complete) return false;
+
+        // A corrupt or mismatched cache must not index out of bounds during traversal
+        auto material_id = [](const auto& item) { return item.mat_id; };
+        if (!valid_tree(tree.nodes, header.sphere_count, header.parallelogram_count) ||
+            !valid_materials(spheres.materials, header.material_count, [](MaterialId id) { return id; }) ||
+            !valid_materials(lights, header.material_count, material_id) ||
+            !valid_materials(parallelograms, header.material_count, material_id) ||
+            !valid_materials(planes, header.material_count, material_id))
+            return false;
+
+        for (const CachedMaterial& m : materials) {
+            Color color(m.color[0], m.color[1], m.color[2]);
+            switch (m.type) {
+            case CachedMatte: scene.materials.add<Matte>(color); break;
+            case CachedMetal: scene.materials.add<Metal>(color, m.parameter); break;
+            case CachedGlass: scene.materials.add<Glass>(m.parameter); break;
+            case CachedLight: scene.materials.add<PointLight>(color); break;
+            default: return false;
+            }
+        }
+        for (const CachedSphereLight& l : lights)
+            scene.lights.lights.push_back({Point3(l.center[0], l.center[1], l.center[2]), l.radius, l.mat_id});
+        tree.parallelograms.reserve(parallelograms.size());
+        for (const CachedParallelogram& p : parallelograms) {
+            tree.parallelograms.emplace_back(Point3(p.q[0], p.q[1], p.q[2]), Vec3(p.u[0], p.u[1], p.u[2]),
+                                             Vec3(p.v[0], p.v[1], p.v[2]), p.mat_id);
+        }
+        for (const CachedPlane& p : planes) {
+            auto plane = make_shared<Plane>();
+            plane->point = Point3(p.point[0], p.point[1], p.point[2]);
+            plane->normal = Vec3(p.normal[0], p.normal[1], p.normal[2]); // Already unit length
+            plane->mat_id = p.mat_id;
+            tree.unbounded.push_back(plane);
+        }
+        tree.num_primitives = header.primitive_count;
+
+        scene.cam_config.origin = Point3(header.camera[0], header.camera[1], header.camera[2]);
+        scene.cam_config.focal_length = static_cast<float>(header.camera[3]);
+        scene.cam_config.viewport_height = static_cast<float>(header.camera[4]);
+        scene.cam_config.aspect_ratio = static_cast<float>(header.camera[5]);
+        scene.bg_color = Color(header.background[0], header.background[1], header.background[2]);
+        scene.object_count = header.object_count;
+        if (touched) restamp(cache_path, source.mtime);
+        return true;
+    } catch (const std::exception&) {
+        // Unreadable cache or scene file: fall back to the XML, which reports its own errors
+        return false;
+    }
+}
+
+bool SceneCache::write(const std::string& cache_path, const SourceStamp& source, const CompiledScene& scene, const BVH& tree) {
+    // Only the primitives the XML format produces can be stored as plain data
+    std::vector<CachedPlane> planes;
+    for (const auto& object : tree.unbounded) {
+        auto plane = std::dynamic_pointer_cast<Plane>(object);
+        if (!plane) return false;
+        planes.push_back({{plane->point.x(), plane->point.y(), plane->point.z()},
+                          {plane->normal.x(), plane->normal.y(), plane->normal.z()}, plane->mat_id, 0});
+    }
+    if (!tree.generics.empty()) return false;
+
+    std::vector<CachedMaterial> materials;
+    for (size_t i = 0; i < scene.materials.size(); ++i) {
+        CachedMaterial cached{};
+        auto store_color = [&](const Color& c) {
+            cached.color[0] = c.x();
+            cached.color[1] = c.y();
+            cached.color[2] = c.z();
+        };
+        scene.materials[static_cast<MaterialId>(i)].visit([&](const auto& m) {
+            using T = std::decay_t<decltype(m)>;
+            if constexpr (std::is_same_v<T, Matte>) {
+                cached.type = CachedMatte;
+                store_color(m.albedo);
+            } else if constexpr (std::is_same_v<T, Metal>) {
+                cached.type = CachedMetal;
+                store_color(m.albedo);
+                cached.parameter = m.fuzz;
+            } else if constexpr (std::is_same_v<T, Glass>) {
+                cached.type = CachedGlass;
+                cached.parameter = m.ir;
+            } else {
+                cached.type = CachedLight;
+                store_color(m.emit_color);
+            }
+        });
+        materials.push_back(cached);
+    }
+
+    std::vector<CachedSphereLight> lights;
+    for (const SphereLight& l : scene.lights.lights)
+        lights.push_back({{l.center.x(), l.center.y(), l.center.z()}, l.radius, l.mat_id, 0});
+
+    std::vector<CachedParallelogram> parallelograms;
+    for (const Parallelogram& p : tree.parallelograms)
+        parallelograms.push_back({{p.Q.x(), p.Q.y(), p.Q.z()}, {p.u.x(), p.u.y(), p.u.z()}, {p.v.x(), p.v.y(), p.v.z()}, p.mat_id, 0});
+
+    try {
+        CacheHeader header{};
+        std::memcpy(header.magic, cache_magic, sizeof(cache_magic));
+        header.version = cache_version;
+        header.byte_order = byte_order;
+        header.sphere_lane_width = SphereSoA::lane_width;
+        header.node_size = sizeof(LinearBVHNode);
+        header.source_size = source.size;
+        header.source_mtime = source.mtime;
+        header.source_hash = source.hash;
+        header.object_count = scene.object_count;
+        header.primitive_count = tree.num_primitives;
+        header.material_count = materials.size();
+        header.light_count = lights.size();
+        header.node_count = tree.nodes.size();
+        header.sphere_count = tree.spheres.size();
+        header.parallelogram_count = parallelograms.size();
+        header.plane_count = planes.size();
+        const CameraConfig& cam = scene.cam_config;
+        double camera[6] = {cam.origin.x(), cam.origin.y(), cam.origin.z(), cam.focal_length, cam.viewport_height, cam.aspect_ratio};
+        std::memcpy(header.camera, camera, sizeof(camera));
+        header.background[0] = scene.bg_color.x();
+        header.background[1] = scene.bg_color.y();
+        header.background[2] = scene.bg_color.z();
+
+        // Write to a temporary file, then rename: a reader never sees a partial cache
+        const std::string temp_path = cache_path + ".tmp";
+        {
+            std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+            if (!out) return false;
+            write_array(out, &header, 1);
+            write_array(out, materials.data(), materials.size());
+            write_array(out, lights.data(), lights.size());
+            write_array(out, tree.nodes.data(), tree.nodes.size());
+            const SphereSoA& spheres = tree.spheres;
+            write_array(out, spheres.center_x.data(), spheres.size());
+            write_array(out, spheres.center_y.data(), spheres.size());
+            write_array(out, spheres.center_z.data(), spheres.size());
+            write_array(out, spheres.radius.data(), spheres.size());
+            write_array(out, spheres.materials.data(), spheres.size());
+            write_array(out, parallelograms.data(), parallelograms.size());
+            write_array(out, planes.data(), planes.size());
+            if (!out.flush()) {
+                out.close();
+                fs::remove(temp_path);
+                return false;
+            }
+        }
+        fs::rename(temp_path, cache_path);
+        return true;
+    } catch (const std::exception&) {
+        // The cache is an optimisation: a scene that cannot be cached is still rendered
+        return false;
+    }
+}
@@ -1,177 +1,268 @@
 #include <iostream>
+#include <charconv>
+#include <stdexcept>
 #include "SceneXMLParser.hpp"
+#include "MappedFile.hpp"
 
-// Remove XML comments (<!-- ... -->)
-std::string SceneXMLParser::removeComments(const std::string& xml) {
-    std::string cleanXml = xml;
-    size_t commentStart = cleanXml.find("<!--");
-    
-    while (commentStart != std::string::npos) {
-        // Find comment end position
-        size_t commentEnd = cleanXml.find("-->", commentStart);
-        if (commentEnd == std::string::npos) {
-            // No end tag, truncate to comment start position (defensive handling)
-            cleanXml.erase(commentStart);
-            break;
-        }
-        // Remove entire comment block (including <!-- and -->)
-        cleanXml.erase(commentStart, commentEnd - commentStart + 3);
-        // Continue to find next comment
-        commentStart = cleanXml.find("<!--", commentStart);
-    }
-    
-    return cleanXml;
+namespace {
+
+// Sub-tags of an object, material and camera (bits of the m_*Fields masks)
+enum ObjectField : unsigned { Position = 1, Radius = 2, Normal = 4, Origin = 8, EdgeU = 16, EdgeV = 32, EdgeW = 64 };
+enum MaterialField : unsigned { ColorField = 1, Fuzz = 2, Ior = 4, Intensity = 8 };
+enum CameraField : unsigned { CameraPosition = 1, FocalLength = 2, ViewportHeight = 4, AspectRatio = 8 };
+
+std::string describe(const XMLTag& tag, std::string_view attribute) {
+    return std::string(attribute) + " in <" + std::string(tag.name) + ">";
 }
 
-// Parse attribute string into key-value pairs
-AttrMap SceneXMLParser::parseAttributes(const std::string& attrStr) {
-    AttrMap attrs;
-    if (attrStr.empty()) return attrs;
+// Parses a number with std::from_chars (no locale, no copy); surrounding spaces and a leading '+' are allowed
+float parseNumber(std::string_view text, const XMLTag& tag, std::string_view attribute) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) text.remove_prefix(1);
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t')) text.remove_suffix(1);
+    if (text.empty()) throw std::runtime_error("Missing number for " + describe(tag, attribute));
+    std::string_view digits = text.front() == '+' ? text.substr(1) : text;
 
-    // Regex match "key="value"" format
-    std::regex attrRegex(R"((\w+)\s*=\s*["']([^"']*)["'])");
-    std::sregex_iterator it(attrStr.begin(), attrStr.end(), attrRegex);
-    std::sregex_iterator end;
+    float value = 0.0f;
+    auto [end, error] = std::from_chars(digits.data(), digits.data() + digits.size(), value);
+    if (error != std::errc() || end != digits.data() + digits.size())
+        throw std::runtime_error("Invalid number \"" + std::string(text) + "\" for " + describe(tag, attribute));
+    return value;
+}
 
-    for (; it != end; ++it) {
-        std::string key = (*it)[1].str();
-        std::string value = (*it)[2].str();
-        attrs[key] = value;
-    }
+// Reads the attribute of a tag as a number
+float readScalar(const XMLTag& tag, std::string_view attribute) {
+    return parseNumber(tag.attribute(attribute), tag, attribute);
+}
 
-    return attrs;
+// Reads <tag x="" y="" z=""/>
+Vec3 readVector(const XMLTag& tag) {
+    float x = readScalar(tag, "x");
+    float y = readScalar(tag, "y");
+    float z = readScalar(tag, "z");
+    return Vec3(x, y, z);
 }
 
-// Process start tags (e.g. <object id="cube_01" type="cube">)
-void SceneXMLParser::processStartTag(const std::string& tagContent) {
-    // Split tag name and attributes
-    size_t spacePos = tagContent.find_first_of(' ');
-    std::string tagName = (spacePos == std::string::npos) ? tagContent : tagContent.substr(0, spacePos);
-    
-    // Extract attribute string
-    std::string attrStr = (spacePos == std::string::npos) ? "" : tagContent.substr(spacePos + 1);
-    AttrMap attrs = parseAttributes(attrStr);
+// Reads <tag r="" g="" b=""/>, with components in [0, 255]
+Color readColor(const XMLTag& tag) {
+    float r = readScalar(tag, "r") / 255.0f;
+    float g = readScalar(tag, "g") / 255.0f;
+    float b = readScalar(tag, "b") / 255.0f;
+    return Color(r, g, b);
+}
 
+// Reads a value that may be written as a fraction (e.g. 16.0/9.0)
+float readRatio(const XMLTag& tag, std::string_view attribute) {
+    std::string_view text = tag.attribute(attribute);
+    size_t div_pos = text.find('/');
+    if (div_pos == std::string_view::npos) return parseNumber(text, tag, attribute);
+    float num = parseNumber(text.substr(0, div_pos), tag, attribute);
+    float den = parseNumber(text.substr(div_pos + 1), tag, attribute);
+    return num / den;
+}
+
+MaterialType materialType(std::string_view name) {
+    if (name == "matte") return MaterialType::Matte;
+    if (name == "metal") return MaterialType::Metal;
+    if (name == "glass") return MaterialType::Glass;
+    if (name == "light") return MaterialType::Light;
+    return MaterialType::Unknown;
+}
+
+ObjectType objectType(std::string_view name) {
+    if (name == "sphere") return ObjectType::Sphere;
+    if (name == "plane") return ObjectType::Plane;
+    if (name == "parallelepiped") return ObjectType::Parallelepiped;
+    return ObjectType::Unknown;
+}
+
+// Names of the sub-tags, indexed by the bit of their field
+const char* const objectFieldNames[] = {"position", "radius", "normal", "origin", "u", "v", "w"};
+const char* const materialFieldNames[] = {"color", "fuzz", "ior", "intensity"};
+const char* const cameraFieldNames[] = {"position", "focal_length", "viewport_height", "aspect_ratio"};
+
+// Throws if a sub-tag required by the type was not given, naming the missing ones
+void requireFields(unsigned seen, unsigned required, const char* const names[], const char* owner, const std::string& id) {
+    if ((seen & required) == required) return;
+    std::string missing;
+    for (int bit = 0; (1u << bit) <= required; ++bit) {
+        if (required & ~seen & (1u << bit)) missing += (missing.empty() ? "<" : ", <") + std::string(names[bit]) + ">";
+    }
+    throw std::runtime_error(std::string(owner) + " '" + id + "': missing " + missing);
+}
+
+} // namespace
+
+// Process start tags (e.g. <object id="cube_01" type="cube">)
+void SceneXMLParser::processStartTag(const XMLTag& tag) {
     // Reset temporary state
-    m_currentParentTag = tagName;
-    if (tagName == "global_settings") {
+    if (tag.name == "global_settings") {
+        m_currentParentTag = ParentTag::GlobalSettings;
         m_currentGlobal = GlobalSettings();
-    } else if (tagName == "object") {
+    } else if (tag.name == "object") {
+        m_currentParentTag = ParentTag::Object;
         m_currentObject = SceneObject();
-        m_currentObject.id = attrs.count("id") ? attrs["id"] : "";
-        m_currentObject.type = attrs.count("type") ? attrs["type"] : "";
-    } else if (tagName == "camera") {
+        m_currentObject.id = tag.attribute("id");
+        m_currentObject.type = objectType(tag.attribute("type"));
+        m_objectFields = 0;
+    } else if (tag.name == "camera") {
+        m_currentParentTag = ParentTag::Camera;
         m_currentCamera = Camera();
-        m_currentCamera.id = attrs.count("id") ? attrs["id"] : "";
-        m_currentCamera.type = attrs.count("type") ? attrs["type"] : "";
-    } else if (tagName == "material") { // Add: Process material start tag
+        m_currentCamera.id = tag.attribute("id");
+        m_currentCamera.type = tag.attribute("type");
+        m_cameraFields = 0;
+    } else if (tag.name == "material") { // Add: Process material start tag
+        m_currentParentTag = ParentTag::Material;
         m_currentMaterial = MaterialObject();
-        m_currentMaterial.type = attrs.count("type") ? attrs["type"] : "";
+        m_currentMaterial.type_name = tag.attribute("type");
+        m_currentMaterial.type = materialType(m_currentMaterial.type_name);
+        m_materialFields = 0;
+    } else {
+        m_currentParentTag = ParentTag::Other;
     }
 }
 
 // Process end tags (e.g. </object>)
-void SceneXMLParser::processEndTag(const std::string& tagName) {
-    if (tagName == "global_settings") {
+void SceneXMLParser::processEndTag(const XMLTag& tag) {
+    if (tag.name == "global_settings") {
         m_sceneData.global_settings = m_currentGlobal;
-    } else if (tagName == "object") {
-        m_sceneData.objects.push_back(m_currentObject);
+    } else if (tag.name == "object") {
+        static constexpr unsigned required[] = {
+            Position | Radius,                // Sphere
+            Position | Normal,                // Plane
+            Origin | EdgeU | EdgeV | EdgeW,   // Parallelepiped
+            0                                 // Unknown: skipped by the scene conversion
+        };
+        requireFields(m_objectFields, required[static_cast<int>(m_currentObject.type)], objectFieldNames,
+                      "Object", m_currentObject.id);
+        m_sceneData.objects.push_back(std::move(m_currentObject));
         m_currentObject = SceneObject(); // Reset
-    } else if (tagName == "camera") {
-        m_sceneData.camera = m_currentCamera;
+    } else if (tag.name == "camera") {
+        // A camera without parameters keeps the default one; otherwise all of them are needed
+        if (m_cameraFields != 0)
+            requireFields(m_cameraFields, CameraPosition | FocalLength | ViewportHeight | AspectRatio, cameraFieldNames,
+                          "Camera", m_currentCamera.id);
+        m_currentCamera.defined = m_cameraFields != 0;
+        m_sceneData.camera = std::move(m_currentCamera);
         m_currentCamera = Camera(); // Reset
-    } else if (tagName == "material") { // Add: Associate to current object when ending material tag
-        m_currentObject.material = m_currentMaterial;
+    } else if (tag.name == "material") { // Add: Associate to current object when ending material tag
+        static constexpr unsigned required[] = {
+            ColorField,          // Matte
+            ColorField | Fuzz,   // Metal
+            Ior,                 // Glass
+            Intensity,           // Light
+            0                    // Unknown: replaced by a grey matte
+        };
+        requireFields(m_materialFields, required[static_cast<int>(m_currentMaterial.type)], materialFieldNames,
+                      "Material of object", m_currentObject.id);
+        m_currentObject.material = std::move(m_currentMaterial);
         m_currentMaterial = MaterialObject(); // Reset temporary material
     }
-    m_currentParentTag = ""; // Clear current parent tag
+    m_currentParentTag = ParentTag::None; // Clear current parent tag
 }
 
 // Process self-closing tags (e.g. <position x="100" y="200" z="0"/>)
-void SceneXMLParser::processSelfClosingTag(const std::string& tagContent) {
-    if (m_currentParentTag.empty()) return;
-
-    // Split sub-tag name and attributes
-    size_t spacePos = tagContent.find_first_of(' ');
-    std::string subTagName = (spacePos == std::string::npos) ? tagContent : tagContent.substr(0, spacePos);
-    std::string attrStr = (spacePos == std::string::npos) ? "" : tagContent.substr(spacePos + 1);
-    AttrMap attrs = parseAttributes(attrStr);
-
-    // Store sub-attributes according to current parent tag
-    // If current parent tag is material, store material sub-attributes
-    if (m_currentParentTag == "material") {
-        m_currentMaterial.properties[subTagName] = attrs;
-    } else if (m_currentParentTag == "global_settings") {
-        m_currentGlobal.properties[subTagName] = attrs;
-    } else if (m_currentParentTag == "object") {
-        m_currentObject.properties[subTagName] = attrs;
-    } else if (m_currentParentTag == "camera") {
-        m_currentCamera.properties[subTagName] = attrs;
+void SceneXMLParser::processSelfClosingTag(const XMLTag& tag) {
+    // Store the typed sub-attributes according to current parent tag; unknown sub-tags are ignored
+    const std::string_view name = tag.name;
+    switch (m_currentParentTag) {
+    case ParentTag::Material:
+        if (name == "color") {
+            m_currentMaterial.color = readColor(tag);
+            m_materialFields |= ColorField;
+        } else if (name == "fuzz") {
+            m_currentMaterial.fuzz = readScalar(tag, "value");
+            m_materialFields |= Fuzz;
+        } else if (name == "ior") {
+            m_currentMaterial.ior = readScalar(tag, "value");
+            m_materialFields |= Ior;
+        } else if (name == "intensity") {
+            m_currentMaterial.intensity = readScalar(tag, "value");
+            m_materialFields |= Intensity;
+        }
+        break;
+    case ParentTag::GlobalSettings:
+        if (name == "background_color") {
+            m_currentGlobal.background_color = readColor(tag);
+            m_currentGlobal.has_background_color = true;
+        }
+        break;
+    case ParentTag::Object:
+        if (name == "position") {
+            m_currentObject.position = readVector(tag);
+            m_objectFields |= Position;
+        } else if (name == "radius") {
+            m_currentObject.radius = readScalar(tag, "value");
+            m_objectFields |= Radius;
+        } else if (name == "normal") {
+            m_currentObject.normal = readVector(tag);
+            m_objectFields |= Normal;
+        } else if (name == "origin") {
+            m_currentObject.origin = readVector(tag);
+            m_objectFields |= Origin;
+        } else if (name == "u") {
+            m_currentObject.u = readVector(tag);
+            m_objectFields |= EdgeU;
+        } else if (name == "v") {
+            m_currentObject.v = readVector(tag);
+            m_objectFields |= EdgeV;
+        } else if (name == "w") {
+            m_currentObject.w = readVector(tag);
+            m_objectFields |= EdgeW;
+        }
+        break;
+    case ParentTag::Camera:
+        if (name == "position") {
+            m_currentCamera.position = readVector(tag);
+            m_cameraFields |= CameraPosition;
+        } else if (name == "focal_length") {
+            m_currentCamera.focal_length = readScalar(tag, "value");
+            m_cameraFields |= FocalLength;
+        } else if (name == "viewport_height") {
+            m_currentCamera.viewport_height = readScalar(tag, "value");
+            m_cameraFields |= ViewportHeight;
+        } else if (name == "aspect_ratio") {
+            m_currentCamera.aspect_ratio = readRatio(tag, "value");
+            m_cameraFields |= AspectRatio;
+        }
+        break;
+    default:
+        break;
     }
 }
 
 // Parse XML string
 SceneData SceneXMLParser::parseString(const std::string& xmlContent) {
+    return parseText(xmlContent);
+}
+
+// Parse XML text in place
+SceneData SceneXMLParser::parseText(std::string_view xmlContent) {
     // Reset parsing state
     m_sceneData = SceneData();
-    m_currentParentTag = "";
+    m_currentParentTag = ParentTag::None;
     m_currentObject = SceneObject();
     m_currentCamera = Camera();
     m_currentGlobal = GlobalSettings();
+    m_currentMaterial = MaterialObject();
+    m_objectFields = m_materialFields = m_cameraFields = 0;
 
-    // Remove comments
-    std::string cleanXml = removeComments(xmlContent);
-
-    // Regex split tags and content (<xxx> or </xxx> or <xxx/>)
-    std::regex tagRegex(R"(<([^>]+)>)");
-    std::sregex_token_iterator it(cleanXml.begin(), cleanXml.end(), tagRegex, {-1, 0});
-    std::sregex_token_iterator end;
-
-    for (; it != end; ++it) {
-        std::string part = (*it).str();
-        // Only trim leading and trailing whitespace, preserve middle spaces (separator between tag name and attributes)
-        // Step 1: Remove leading whitespace
-        part.erase(part.begin(), std::find_if(part.begin(), part.end(), [](unsigned char ch) {
-            return !std::isspace(ch);
-        }));
-        // Step 2: Remove trailing whitespace
-        part.erase(std::find_if(part.rbegin(), part.rend(), [](unsigned char ch) {
-            return !std::isspace(ch);
-        }).base(), part.end());
-        if (part.empty()) continue;
-
-        // Process start tag (<tag...>)
-        if (part.starts_with("<") && !part.starts_with("</") && !part.ends_with("/>")) {
-            std::string tagContent = part.substr(1, part.size() - 2); // Remove < >
-            processStartTag(tagContent);
-        }
-        // Process end tag (</tag>)
-        else if (part.starts_with("</") && part.ends_with(">")) {
-            std::string tagName = part.substr(2, part.size() - 3); // Remove </ >
-            processEndTag(tagName);
-        }
-        // Process self-closing tag (<tag.../>)
-        else if (part.starts_with("<") && part.ends_with("/>")) {
-            std::string tagContent = part.substr(1, part.size() - 3); // Remove < />
-            processSelfClosingTag(tagContent);
+    // Read the tags in one pass; comments and text between tags are ignored
+    XMLTokenizer tokenizer(xmlContent);
+    XMLTag tag;
+    while (tokenizer.next(tag)) {
+        switch (tag.kind) {
+        case XMLTag::Start:       processStartTag(tag); break;
+        case XMLTag::End:         processEndTag(tag); break;
+        case XMLTag::SelfClosing: processSelfClosingTag(tag); break;
         }
     }
 
-    return m_sceneData;
+    return std::move(m_sceneData);
 }
 
 // Parse XML file
 SceneData SceneXMLParser::parseFile(const std::string& filePath) {
-    // Read file content
-    std::ifstream file(filePath);
-    if (!file.is_open()) {
-        throw std::runtime_error("Failed to open XML file: " + filePath);
-    }
-
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    file.close();
-
-    // Parse string
-    return parseString(buffer.str());
-}
\ No newline at end of file
+    // Map the file and tokenize it in place, without copying it into a string
+    MappedFile file(filePath);
+    return parseText(file.view());
+}
@@ -0,0 +1,201 @@
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include "Wavefront.hpp"
+
+namespace {
+
+// A pixel of the batch: its samples are the paths [first_path, first_path + samples)
+struct BatchPixel {
+    int i, j;
+    int first_sample; // Index of the pixel's first sample (passes continue the pixel's sequence)
+    uint32_t first_path;
+    int samples;
+};
+
+// A tile of the batch and the number of paths it contributed
+struct BatchTile {
+    Tile tile;
+    size_t paths;
+};
+
+/**
+ * @struct WavefrontBuffers
+ * @brief The queues of one thread's wavefront, reused from batch to batch.
+ */
+struct WavefrontBuffers {
+    std::vector<BatchTile> tiles;
+    std::vector<BatchPixel> pixels;
+    std::vector<PathState> paths;
+    std::vector<uint32_t> path_pixel;    // Pixel (index in `pixels`) of each path
+
+    std::vector<uint32_t> active;        // Live paths of the current bounce, in path order
+    std::vector<uint32_t> hit_paths;     // Live paths that hit something...
+    std::vector<HitRecord> hit_records;  // ...and their hits
+    std::vector<uint32_t> shading_order; // Indices into hit_paths, grouped by material type
+    std::vector<uint8_t> alive;          // Whether each path continues after the bounce
+    std::vector<ShadowRay> shadows;      // Shadow rays of the bounce...
+    std::vector<uint32_t> shadow_paths;  // ...and the path each one belongs to
+};
+
+// Restarts the sampler on the sample that path `path` traces
+inline void start_path_sample(Sampler& sampler, const WavefrontBuffers& buffers, uint32_t path) {
+    const BatchPixel& pixel = buffers.pixels[buffers.path_pixel[path]];
+    sampler.start_pixel_sample(pixel.i, pixel.j, pixel.first_sample + static_cast<int>(path - pixel.first_path));
+}
+
+} // namespace
+
+void render_blocks_wavefront(int thread_id,
+                             TileScheduler& scheduler,
+                             const SceneBaseObject& world,
+                             const MaterialTable& materials,
+                             const LightList& lights,
+                             const Point3& origin, const Vec3& horizontal, const Vec3& vertical,
+                             const Point3& lower_left_corner,
+                             int image_width, int image_height,
+                             int samples_per_pixel, int max_depth, int rr_min_depth,
+                             const Color& bg_color,
+                             Film& film,
+                             std::atomic<int>& completed_tiles,
+                             const ProgressCallback& progress,
+                             const std::atomic<bool>* cancel,
+                             const AdaptiveSampling* adaptive,
+                             const Sampler* sampler) {
+    const int total_tiles = static_cast<int>(scheduler.tile_count());
+    Tile tile;
+
+    // Samplers keep per-sample state: every thread works on its own copy
+    std::unique_ptr<Sampler> thread_sampler = sampler ? sampler->clone() : std::make_unique<IndependentSampler>();
+    WavefrontBuffers buffers;
+
+    while (true) {
+        // 1. Gather the paths of whole tiles until the batch is large enough
+        buffers.tiles.clear();
+        buffers.pixels.clear();
+        buffers.path_pixel.clear();
+        while (buffers.path_pixel.size() < wavefront_batch_paths && scheduler.next(thread_id, tile)) {
+            size_t tile_first_path = buffers.path_pixel.size();
+            for (int j = tile.y0; j < tile.y1; ++j) {
+                for (int i = tile.x0; i < tile.x1; ++i) {
+                    int pixel_samples = samples_per_pixel;
+                    if (adaptive) {
+                        if (film.converged(i, j, *adaptive)) continue;
+                        pixel_samples = std::min(pixel_samples, adaptive->max_samples - film.samples(i, j));
+                    }
+                    pixel_samples = std::max(pixel_samples, 0);
+                    uint32_t first_path = static_cast<uint32_t>(buffers.path_pixel.size());
+                    buffers.pixels.push_back({i, j, film.samples(i, j), first_path, pixel_samples});
+                    buffers.path_pixel.insert(buffers.path_pixel.end(), pixel_samples,
+                                              static_cast<uint32_t>(buffers.pixels.size() - 1));
+                }
+            }
+            buffers.tiles.push_back({tile, buffers.path_pixel.size() - tile_first_path});
+        }
+        if (buffers.tiles.empty()) return;
+
+        auto batch_start = std::chrono::steady_clock::now();
+        const uint32_t path_count = static_cast<uint32_t>(buffers.path_pixel.size());
+
+        // 2. Camera rays, jittered inside their pixel
+        buffers.paths.assign(path_count, PathState());
+        buffers.active.resize(path_count);
+        for (uint32_t p = 0; p < path_count; ++p) {
+            const BatchPixel& pixel = buffers.pixels[buffers.path_pixel[p]];
+            int original_j = image_height - 1 - pixel.j; // Buffer rows go top-down, v goes bottom-up
+            start_path_sample(*thread_sampler, buffers, p);
+            double du, dv;
+            thread_sampler->get_2d(du, dv);
+            auto u = (pixel.i + du) / (image_width-1);
+            auto v = (original_j + dv) / (image_height-1);
+            buffers.paths[p].ray = Ray(origin, lower_left_corner + u*horizontal + v*vertical - origin);
+            buffers.active[p] = p;
+        }
+        buffers.alive.assign(path_count, 0);
+
+        // 3. Advance all live paths one bounce at a time
+        for (int depth = 0; depth < max_depth && !buffers.active.empty(); ++depth) {
+            if (cancel && cancel->load(std::memory_order_relaxed)) return;
+
+            // Intersection: misses take the background color and end
+            buffers.hit_paths.clear();
+            buffers.hit_records.clear();
+            for (uint32_t p : buffers.active) {
+                PathState& path = buffers.paths[p];
+                HitRecord rec;
+                if (world.hit(path.ray, 0.001, infinity, rec)) {
+                    buffers.hit_paths.push_back(p);
+                    buffers.hit_records.push_back(rec);
+                } else {
+                    path.radiance += path.throughput * bg_color;
+                }
+            }
+
+            // Binning: counting sort of the hits by material type
+            std::array<uint32_t, Material::type_count + 1> bin_start{};
+            for (const HitRecord& rec : buffers.hit_records)
+                ++bin_start[materials[rec.mat_id].type_index() + 1];
+            for (size_t type = 0; type < Material::type_count; ++type)
+                bin_start[type + 1] += bin_start[type];
+            buffers.shading_order.resize(buffers.hit_records.size());
+            for (uint32_t k = 0; k < buffers.hit_records.size(); ++k)
+                buffers.shading_order[bin_start[materials[buffers.hit_records[k].mat_id].type_index()]++] = k;
+
+            // Shading, one material type after the other
+            buffers.shadows.clear();
+            buffers.shadow_paths.clear();
+            for (uint32_t k : buffers.shading_order) {
+                uint32_t p = buffers.hit_paths[k];
+                start_path_sample(*thread_sampler, buffers, p);
+                ShadowRay shadow;
+                buffers.alive[p] = shade_hit(buffers.paths[p], buffers.hit_records[k], materials, lights,
+                                             rr_min_depth, *thread_sampler, shadow);
+                if (shadow.pending) {
+                    buffers.shadows.push_back(shadow);
+                    buffers.shadow_paths.push_back(p);
+                }
+            }
+
+            // Shadow rays of the bounce, as one batch of any-hit queries
+            for (size_t k = 0; k < buffers.shadows.size(); ++k) {
+                const ShadowRay& shadow = buffers.shadows[k];
+                if (!world.occluded(shadow.ray, 0.001, shadow.t_max))
+                    buffers.paths[buffers.shadow_paths[k]].radiance += shadow.contribution;
+            }
+
+            // Compaction: the surviving paths, still in path (i.e. screen) order
+            size_t survivors = 0;
+            for (uint32_t p : buffers.active) {
+                if (buffers.alive[p]) buffers.active[survivors++] = p;
+                buffers.alive[p] = 0;
+            }
+            buffers.active.resize(survivors);
+        }
+
+        // 4. Add the samples to the film, pixel by pixel and in sample order
+        for (const BatchPixel& pixel : buffers.pixels) {
+            Color pixel_color(0,0,0);
+            double lum_sum = 0.0, lum_sq_sum = 0.0;
+            for (int s = 0; s < pixel.samples; ++s) {
+                const Color& sample = buffers.paths[pixel.first_path + s].radiance;
+                double lum = Film::luminance(sample);
+                pixel_color += sample;
+                lum_sum += lum;
+                lum_sq_sum += lum * lum;
+            }
+            film.add(pixel.i, pixel.j, pixel_color, lum_sum, lum_sq_sum, pixel.samples);
+        }
+
+        // 5. The tiles of the batch are done: their time is shared in proportion to their paths
+        std::chrono::duration<double> batch_time = std::chrono::steady_clock::now() - batch_start;
+        for (const BatchTile& batch_tile : buffers.tiles) {
+            double share = path_count > 0 ? static_cast<double>(batch_tile.paths) / path_count
+                                          : 1.0 / buffers.tiles.size();
+            scheduler.record(batch_tile.tile, thread_id, batch_time.count() * share);
+
+            // Release this tile's film writes; the thread that counts the last tile sees all of them
+            int finished = completed_tiles.fetch_add(1, std::memory_order_acq_rel) + 1;
+            if (progress) progress(batch_tile.tile, finished, total_tiles);
+        }
+    }
+}
@@ -0,0 +1,202 @@
+#include <bit>
+#include <cmath>
+#include "WideBVH.hpp"
+
+namespace {
+    // Next float above / below v (PBRT's NextFloatUp / NextFloatDown)
+    float next_float_up(float v) {
+        if (std::isinf(v) && v > 0) return v;
+        if (v == -0.0f) v = 0.0f;
+        uint32_t bits = std::bit_cast<uint32_t>(v);
+        return std::bit_cast<float>(v >= 0 ? bits + 1 : bits - 1);
+    }
+
+    float next_float_down(float v) {
+        if (std::isinf(v) && v < 0) return v;
+        if (v == 0.0f) v = -0.0f;
+        uint32_t bits = std::bit_cast<uint32_t>(v);
+        return std::bit_cast<float>(v > 0 ? bits - 1 : bits + 1);
+    }
+
+    double node_area(const LinearBVHNode& node) {
+        double dx = node.bounds_max[0] - node.bounds_min[0];
+        double dy = node.bounds_max[1] - node.bounds_min[1];
+        double dz = node.bounds_max[2] - node.bounds_min[2];
+        return 2.0 * (dx * dy + dy * dz + dz * dx);
+    }
+}
+
+WideBVH::RayPacket4::RayPacket4(const Ray& r) {
+    for (int a = 0; a < 3; ++a) {
+        inv_dir[a] = static_cast<float>(1.0 / r.direction()[a]);
+        near_side[a] = inv_dir[a] < 0 ? 1 : 0;
+        // Floats just below and above the origin (the same float when it is exact): moving the
+        // origin towards the box lowers the near distance, away from it raises the far one
+        const double exact = r.origin()[a];
+        float origin = static_cast<float>(exact);
+        float lower = origin <= exact ? origin : next_float_down(origin);
+        float upper = origin >= exact ? origin : next_float_up(origin);
+        near_origin[a] = near_side[a] == 0 ? upper : lower;
+        far_origin[a] = near_side[a] == 0 ? lower : upper;
+    }
+}
+
+WideBVH::WideBVH(const Scene& scene) : WideBVH(BVH(scene)) {}
+
+WideBVH::WideBVH(BVH tree) : binary(std::move(tree)) {
+    if (binary.nodes.empty()) return;
+    nodes.reserve(binary.nodes.size() / 2 + 1);
+    collapse(0);
+}
+
+// Build the wide node covering the binary subtree rooted at binary_index
+uint32_t WideBVH::collapse(uint32_t binary_index) {
+    // 1. Gather up to four binary subtrees, always opening the largest interior one
+    uint32_t children[4];
+    int n = 0;
+    const LinearBVHNode& top = binary.nodes[binary_index];
+    if (top.primitive_count > 0) {
+        children[n++] = binary_index;
+    } else {
+        children[n++] = binary_index + 1;
+        children[n++] = top.second_child_offset;
+        while (n < 4) {
+            int best = -1;
+            double best_area = -1.0;
+            for (int i = 0; i < n; ++i) {
+                const LinearBVHNode& node = binary.nodes[children[i]];
+                if (node.primitive_count == 0 && node_area(node) > best_area) {
+                    best_area = node_area(node);
+                    best = i;
+                }
+            }
+            if (best < 0) break; // Only leaves left
+
+            uint32_t opened = children[best];
+            children[best] = opened + 1;
+            children[n++] = binary.nodes[opened].second_child_offset;
+        }
+    }
+
+    // 2. Emit the node; empty slots get an inverted box that no ray can hit
+    uint32_t index = static_cast<uint32_t>(nodes.size());
+    nodes.emplace_back();
+    for (int c = 0; c < 4; ++c) {
+        for (int a = 0; a < 3; ++a) {
+            nodes[index].bounds[0][a][c] = c < n ? binary.nodes[children[c]].bounds_min[a] : INFINITY;
+            nodes[index].bounds[1][a][c] = c < n ? binary.nodes[children[c]].bounds_max[a] : -INFINITY;
+        }
+    }
+
+    // 3. Recurse (may reallocate nodes, so only index into it afterwards)
+    for (int c = 0; c < 4; ++c) {
+        uint32_t child = WideBVHNode::empty_child;
+        if (c < n) {
+            const LinearBVHNode& node = binary.nodes[children[c]];
+            child = node.primitive_count > 0 ? (WideBVHNode::leaf_flag | children[c]) : collapse(children[c]);
+        }
+        nodes[index].child[c] = child;
+    }
+    return index;
+}
+
+bool WideBVH::hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const {
+    bool hit_anything = false;
+    double closest_so_far = t_max;
+
+    // Infinite objects are tested linearly
+    for (const auto& object : binary.unbounded) {
+        if (object->hit(r, t_min, closest_so_far, rec)) {
+            hit_anything = true;
+            closest_so_far = rec.t;
+        }
+    }
+
+    if (nodes.empty()) return hit_anything;
+
+    const RayPacket4 ray(r);
+
+    uint32_t to_visit[stack_size];
+    int to_visit_offset = 0;
+    to_visit[to_visit_offset++] = 0;
+
+    while (to_visit_offset > 0) {
+        uint32_t current = to_visit[--to_visit_offset];
+
+        // Leaf: reuse the primitive code of the binary BVH
+        if (current & WideBVHNode::leaf_flag) {
+            const LinearBVHNode& leaf = binary.nodes[current & ~WideBVHNode::leaf_flag];
+            if (binary.hit_leaf(leaf, r, t_min, closest_so_far, rec)) {
+                hit_anything = true;
+                closest_so_far = rec.t;
+            }
+            continue;
+        }
+
+        const WideBVHNode& node = nodes[current];
+        float t_near[4];
+        int mask = hit_children(node, ray, static_cast<float>(t_min), static_cast<float>(closest_so_far), t_near);
+
+        // Push the hit children far-to-near, so that the nearest is visited first
+        uint32_t hit_child[4];
+        float hit_t[4];
+        int n = 0;
+        for (int c = 0; c < 4; ++c) {
+            if (!(mask & (1 << c)) || node.child[c] == WideBVHNode::empty_child) continue;
+            int k = n++;
+            while (k > 0 && hit_t[k - 1] < t_near[c]) {
+                hit_t[k] = hit_t[k - 1];
+                hit_child[k] = hit_child[k - 1];
+                --k;
+            }
+            hit_t[k] = t_near[c];
+            hit_child[k] = node.child[c];
+        }
+        for (int i = 0; i < n; ++i) {
+            to_visit[to_visit_offset++] = hit_child[i];
+        }
+    }
+
+    return hit_anything;
+}
+
+bool WideBVH::occluded(const Ray& r, double t_min, double t_max) const {
+    for (const auto& object : binary.unbounded) {
+        if (object->occluded(r, t_min, t_max)) return true;
+    }
+
+    if (nodes.empty()) return false;
+
+    const RayPacket4 ray(r);
+    const float box_t_min = static_cast<float>(t_min);
+    const float box_t_max = static_cast<float>(t_max);
+
+    uint32_t to_visit[stack_size];
+    int to_visit_offset = 0;
+    to_visit[to_visit_offset++] = 0;
+
+    while (to_visit_offset > 0) {
+        uint32_t current = to_visit[--to_visit_offset];
+
+        if (current & WideBVHNode::leaf_flag) {
+            const LinearBVHNode& leaf = binary.nodes[current & ~WideBVHNode::leaf_flag];
+            if (binary.occluded_leaf(leaf, r, t_min, t_max)) return true;
+            continue;
+        }
+
+        // Any blocker will do: push the hit children without sorting them
+        const WideBVHNode& node = nodes[current];
+        float t_near[4];
+        int mask = hit_children(node, ray, box_t_min, box_t_max, t_near);
+        for (int c = 0; c < 4; ++c) {
+            if ((mask & (1 << c)) && node.child[c] != WideBVHNode::empty_child)
+                to_visit[to_visit_offset++] = node.child[c];
+        }
+    }
+
+    return false;
+}
+
+bool WideBVH::bounding_box(AABB& output_box) const {
+    return binary.bounding_box(output_box);
+}
@@ -0,0 +1,252 @@
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+#include <filesystem>
+#include "SavePng.hpp"
+#include "Scene.hpp"
+#include "Accelerator.hpp"
+#include "Light.hpp"
+#include "RenderUtils.hpp"
+#include "SceneXMLParser.hpp"
+#include "BatchRenderer.hpp"
+
+/**
+ * @file render_cli.cpp
+ * @brief Headless batch renderer: renders one XML scene to a PNG file, without a display.
+ *
+ * Uses the same parser, scene conversion, acceleration structures and tile
+ * renderer as the GUI. Progress and diagnostics go to stderr; stdout only
+ * receives one line of `key=value` pairs with the timing of each phase (in
+ * seconds), so that render servers can collect it with a script:
+ *
+ *      scene=../scene/beach.xml width=400 height=225 spp=400 depth=50 threads=8 parse=0.0004 build=0.0001 render=3.21 encode=0.012 total=3.22
+ *
+ * With `--batch`, every scene of a directory or manifest is rendered over one
+ * shared pool of threads (see render_batch), and stdout receives one such line
+ * per scene followed by a line with the batch totals.
+ */
+
+namespace {
+
+struct CliOptions {
+    std::string scene_path;
+    std::string batch_source; // Directory or manifest of scenes (batch mode)
+    std::string output_path;  // Default render.png, or the current directory in batch mode
+    int image_width = 400;
+    int samples_per_pixel = 400;
+    int max_depth = 50;
+    int num_threads = 0; // 0: hardware core count
+    AcceleratorType accel = AcceleratorType::Binary;
+    SamplerType sampler = SamplerType::Sobol;
+    RenderEngine engine = RenderEngine::Megakernel;
+};
+
+void print_usage(const char* program) {
+    std::cerr << "Usage: " << program << " <scene.xml> [options]\n"
+              << "       " << program << " --batch <directory|manifest> [options]\n"
+              << "      --batch <source>      Render all the .xml files of a directory, or the scenes listed in a file (one per line)\n"
+              << "  -o, --output <path>       Output image (default render.png); in batch mode, output directory (default .)\n"
+              << "  -w, --width <pixels>      Image width; the height follows the camera aspect ratio (default 400)\n"
+              << "  -s, --spp <samples>       Samples per pixel (default 400)\n"
+              << "  -d, --depth <bounces>     Maximum number of bounces (default 50)\n"
+              << "  -t, --threads <count>     Rendering threads (default: all cores)\n"
+              << "      --accel <bvh2|bvh4>   Acceleration structure (default RT_ACCEL, or bvh2)\n"
+              << "      --sampler <name>      independent, stratified, sobol or bluenoise (default RT_SAMPLER, or sobol)\n"
+              << "      --engine <name>       megakernel or wavefront (default RT_ENGINE, or megakernel)\n";
+}
+
+// Parses a strictly positive integer option value
+int parse_positive(const std::string& option, const std::string& value) {
+    size_t used = 0;
+    int number = 0;
+    try {
+        number = std::stoi(value, &used);
+    } catch (const std::exception&) {
+        used = 0;
+    }
+    if (used != value.size() || number <= 0)
+        throw std::invalid_argument("Invalid value for " + option + ": " + value);
+    return number;
+}
+
+/**
+ * @brief Reads the command line; the environment variables of the GUI are the defaults.
+ * @throw std::invalid_argument on unknown options or invalid values.
+ */
+CliOptions parse_options(int argc, char** argv) {
+    CliOptions options;
+    if (const char* accel_env = std::getenv("RT_ACCEL")) options.accel = parse_accelerator_type(accel_env);
+    if (const char* sampler_env = std::getenv("RT_SAMPLER")) options.sampler = parse_sampler_type(sampler_env);
+    if (const char* engine_env = std::getenv("RT_ENGINE")) options.engine = parse_render_engine(engine_env);
+
+    for (int k = 1; k < argc; ++k) {
+        std::string arg = argv[k];
+        if (arg.empty() || arg[0] != '-') {
+            if (!options.scene_path.empty()) throw std::invalid_argument("More than one scene given: " + arg);
+            options.scene_path = arg;
+            continue;
+        }
+        if (k + 1 >= argc) throw std::invalid_argument("Missing value for " + arg);
+        std::string value = argv[++k];
+        if (arg == "--batch") options.batch_source = value;
+        else if (arg == "-o" || arg == "--output") options.output_path = value;
+        else if (arg == "-w" || arg == "--width") options.image_width = parse_positive(arg, value);
+        else if (arg == "-s" || arg == "--spp") options.samples_per_pixel = parse_positive(arg, value);
+        else if (arg == "-d" || arg == "--depth") options.max_depth = parse_positive(arg, value);
+        else if (arg == "-t" || arg == "--threads") options.num_threads = parse_positive(arg, value);
+        else if (arg == "--accel") options.accel = parse_accelerator_type(value);
+        else if (arg == "--sampler") options.sampler = parse_sampler_type(value);
+        else if (arg == "--engine") options.engine = parse_render_engine(value);
+        else throw std::invalid_argument("Unknown option: " + arg);
+    }
+    if (!options.batch_source.empty()) {
+        if (!options.scene_path.empty()) throw std::invalid_argument("A scene and --batch cannot both be given");
+        if (options.output_path.empty()) options.output_path = ".";
+    } else {
+        if (options.scene_path.empty()) throw std::invalid_argument("No scene given");
+        if (options.output_path.empty()) options.output_path = "render.png";
+    }
+    return options;
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Renders every scene of options.batch_source into the directory options.output_path
+int run_batch(const CliOptions& options, int num_threads, int rr_min_depth) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::string> scenes;
+    try {
+        scenes = collect_batch_scenes(options.batch_source);
+        std::filesystem::create_directories(options.output_path);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    if (scenes.empty()) {
+        std::cerr << "No scene found in " << options.batch_source << "\n";
+        return 1;
+    }
+    std::cerr << "Batch of " << scenes.size() << " scenes, acceleration structure: " << accelerator_name(options.accel)
+              << ", sampler: " << sampler_name(options.sampler)
+              << ", render engine: " << render_engine_name(options.engine) << "\n";
+
+    BatchSettings settings;
+    settings.output_dir = options.output_path;
+    settings.image_width = options.image_width;
+    settings.samples_per_pixel = options.samples_per_pixel;
+    settings.max_depth = options.max_depth;
+    settings.rr_min_depth = rr_min_depth;
+    settings.num_threads = num_threads;
+    settings.accel = options.accel;
+    settings.sampler = options.sampler;
+    settings.engine = options.engine;
+    std::vector<BatchJobReport> reports = render_batch(scenes, settings, std::cerr);
+    print_batch_summary(reports, settings, seconds_since(start), std::cout);
+
+    bool all_done = std::all_of(reports.begin(), reports.end(),
+                                [](const BatchJobReport& report) { return report.error.empty(); });
+    return all_done ? 0 : 1;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    CliOptions options;
+    try {
+        options = parse_options(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        print_usage(argv[0]);
+        return 2;
+    }
+    const int rr_min_depth = 3; // Bounces before Russian roulette may end a path
+    const int num_threads = options.num_threads > 0 ? options.num_threads
+                                                    : (std::thread::hardware_concurrency() ?: 4);
+    if (!options.batch_source.empty()) return run_batch(options, num_threads, rr_min_depth);
+
+    // 1. Parse the XML scene
+    auto start = std::chrono::steady_clock::now();
+    SceneXMLParser parser;
+    SceneData parsed_data;
+    try {
+        parsed_data = parser.parseFile(options.scene_path);
+    } catch (const std::exception& e) {
+        std::cerr << "Scene parsing failed: " << e.what() << "\n";
+        return 1;
+    }
+    double parse_seconds = seconds_since(start);
+    std::cerr << "Scene parsed successfully: " << options.scene_path << ", total " << parsed_data.objects.size() << " objects\n";
+
+    // 2. Build the render scene, its acceleration structure and light list
+    auto phase_start = std::chrono::steady_clock::now();
+    Scene render_scene;
+    CameraConfig cam_config;
+    Color bg_color(0.05, 0.05, 0.1); // Default background color
+    convertSceneDataToRenderScene(parsed_data, render_scene, cam_config, bg_color);
+    shared_ptr<SceneBaseObject> world = build_accelerator(render_scene, options.accel);
+    LightList lights(render_scene);
+    double build_seconds = seconds_since(phase_start);
+    std::cerr << "Acceleration structure: " << accelerator_name(options.accel)
+              << ", sampler: " << sampler_name(options.sampler)
+              << ", render engine: " << render_engine_name(options.engine) << "\n";
+
+    // 3. Render
+    phase_start = std::chrono::steady_clock::now();
+    const int image_width = options.image_width;
+    Viewport view = make_viewport(cam_config, image_width);
+    const int image_height = view.image_height;
+    if (image_height <= 0) {
+        std::cerr << "Image width " << image_width << " is too small for the camera aspect ratio\n";
+        return 2;
+    }
+    std::unique_ptr<Sampler> sampler = make_sampler(options.sampler, options.samples_per_pixel);
+    Film film(image_width, image_height);
+    std::atomic<int> completed_tiles{0};
+    TileScheduler scheduler(image_width, image_height, num_threads);
+    render_tiles(num_threads,
+                 scheduler,
+                 *world,
+                 render_scene.materials,
+                 lights,
+                 view.origin, view.horizontal, view.vertical,
+                 view.lower_left_corner,
+                 image_width, image_height,
+                 options.samples_per_pixel, options.max_depth, rr_min_depth,
+                 bg_color,
+                 film,
+                 completed_tiles,
+                 nullptr, nullptr, nullptr,
+                 sampler.get(),
+                 options.engine);
+    double render_seconds = seconds_since(phase_start);
+    scheduler.print_report(std::cerr);
+
+    // 4. Encode the PNG
+    phase_start = std::chrono::steady_clock::now();
+    PPMImage image{image_width, image_height, 255, std::vector<unsigned char>(static_cast<size_t>(image_width) * image_height * 3)};
+    film.write_rgb(image.pixels.data());
+    try {
+        write_png(image, options.output_path);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    double encode_seconds = seconds_since(phase_start);
+    std::cerr << "Image written to " << options.output_path << "\n";
+
+    std::cout << "scene=" << options.scene_path
+              << " width=" << image_width << " height=" << image_height
+              << " spp=" << options.samples_per_pixel << " depth=" << options.max_depth
+              << " threads=" << num_threads
+              << " parse=" << parse_seconds << " build=" << build_seconds
+              << " render=" << render_seconds << " encode=" << encode_seconds
+              << " total=" << seconds_since(start) << std::endl;
+    return 0;
+}
@@ -5,372 +5,417 @@
 #include <atomic>
 #include <vector>
 #include <mutex>
+#include <memory>
+#include <cstring>
+#include <algorithm>
 #include "SavePng.hpp"
 #include "Object.hpp"
 #include "Scene.hpp"
+#include "Accelerator.hpp"
+#include "Light.hpp"
+#include "RenderUtils.hpp"
 #include "SceneXMLParser.hpp"
+#include "SceneCache.hpp"
 #include "GUI.hpp"
-#include <omp.h>
 #include <sstream>  // For building strings with timestamps
 #include <iomanip>  // For formatting floating-point precision
 
 /**
- * @brief Calculate the final color seen by a specific ray
- * @param r The ray.
- * @param world The scene.
- * @param depth Maximum number of ray bounces
- * @return The final color of the pixel
+ * @struct RenderJob
+ * @brief One render of one scene, executed on a background thread.
+ *
+ * The FLTK thread only starts and cancels jobs. Everything else (parsing, BVH
+ * build, tracing) runs on the job's worker thread, which itself becomes thread 0
+ * of the render, so every rendering thread traces and none of them handles GUI
+ * events. The worker never touches a widget: it posts Fl::awake() messages,
+ * which FLTK runs on its own thread (see on_render_update / on_render_done).
+ *
+ * Each message carries a heap-allocated shared_ptr to the job, so the job
+ * outlives the messages still queued for it; messages of a job that is no
+ * longer the current one are simply dropped.
+ *
+ * In progressive mode the samples are accumulated in a Film over passes of
+ * 1, 2, 4, ... samples per pixel, and the whole image is previewed after each
+ * pass: a noisy but complete image appears after the first pass, and stopping
+ * the job at any time leaves a usable image.
+ *
+ * With adaptive sampling the job also runs in passes, but each pass only
+ * samples the pixels that are still noisy, until the average budget of
+ * samples_per_pixel is spent or every pixel has converged.
  */
+struct RenderJob {
+    std::string xml_path;
+    bool progressive = false;
+    bool adaptive = false;
+    std::thread worker;
+
+    std::atomic<bool> cancel{false};   // Set by the GUI; render threads stop at the next 8x8 pixel block
+    std::atomic<int> completed_tiles{0}; // Tiles finished in the current pass
+    std::atomic<int> samples_done{0};  // Samples per pixel of the finished passes
+    std::atomic<int> pass_samples{0};  // Samples per pixel of the current pass
+    std::atomic<int> total_tiles{0};   // Tiles of the current pass (rewritten by each pass)
+    std::atomic<long long> next_update_ns{0}; // Throttles the preview messages
+
+    // Written by the worker before it posts a message, read by the GUI thread in the handler
+    int image_width = 0;
+    int image_height = 0;
+    int samples_per_pixel = 0;
+    double seconds = 0;
+    std::string error; // Non-empty if the scene could not be loaded
+    std::vector<unsigned char> spp_heatmap; // RGB heatmap of the samples per pixel (finished adaptive render)
+
+    // 8-bit RGB copy of the finished tiles, shown as the (partial) image
+    std::mutex preview_mutex;
+    std::vector<unsigned char> preview;
+};
+
+std::shared_ptr<RenderJob> current_job; // Latest job started (only used by the FLTK thread)
+
+// Minimum time between two preview updates posted by a job
+constexpr long long preview_interval_ns = 100000000; // 100 ms
+
+// Largest progressive pass, in samples per pixel (passes double up to it)
+constexpr int max_pass_samples = 16;
 
-// Global variables to store camera/background color parameters parsed from XML
-Point3 camera_origin;
-float camera_focal_length;
-float camera_viewport_height;
-float camera_aspect_ratio;
-Color bg_color(0.05, 0.05, 0.1); // Default background color
-
-// Pixel structure
-struct Pixel { int r, g, b; };
-
-Color ray_color(const Ray& r, const SceneBaseObject& world, int depth) {
-    HitRecord rec;
-
-    // Recursion depth limit
-    if (depth <= 0)
-        return Color(0,0,0);
-
-    // Background color (if no objects are hit)
-    // To clearly see the effect of point light sources, we change the originally bright sky to [pure black] or [faint starlight]
-    if (!world.hit(r, 0.001, infinity, rec)) {
-        // Return faint ambient light (0.05, 0.05, 0.05)
-        return bg_color;
-
-        // // If no hit, return sky background color
-        // Vec3 unit_direction = unit_vector(r.direction());
-        // auto t = 0.5 * (unit_direction.y() + 1.0);
-        // return (1.0-t)*Color(1.0, 1.0, 1.0) + t*Color(0.5, 0.7, 1.0);
+/**
+ * @brief Displays an RGB image (3 bytes per pixel) in the display box, scaled to fit.
+ */
+void show_rgb_image(const unsigned char* rgb, int image_width, int image_height) {
+    Fl_Box* display_box = app_state.render_display_box;
+    if (!display_box || !rgb || image_width <= 0 || image_height <= 0) return;
+
+    // Convert to FLTK RGB image (3 bytes per pixel)
+    Fl_RGB_Image* rgb_img = new Fl_RGB_Image(rgb, image_width, image_height, 3);
+
+    // Adaptive scaling (maintain aspect ratio, fit display box)
+    int box_w = display_box->w();
+    int box_h = display_box->h();
+    float img_aspect = (float)image_width / image_height;
+    float box_aspect = (float)box_w / box_h;
+    int draw_w, draw_h;
+
+    if (img_aspect > box_aspect) {
+        // Image is wider, scale by display box width
+        draw_w = box_w;
+        draw_h = static_cast<int>(box_w / img_aspect);
+    } else {
+        // Image is taller, scale by display box height
+        draw_h = box_h;
+        draw_w = static_cast<int>(box_h * img_aspect);
     }
 
-    Ray scattered;
-    Color attenuation;
-    
-    // Get the self-illuminated color of the object itself
-    // Black for ordinary objects, bright color for light sources
-    Color emitted = rec.mat_ptr->emit(rec.p);
-
-    // Attempt to scatter (reflection/refraction)
-    if (!rec.mat_ptr->scatter(r, rec, attenuation, scattered))
-        return emitted; // If no scattering (e.g., hit a light), return the light color directly
-
-    // Final color = self-illumination + (attenuation * color from reflected light)
-    return emitted + attenuation * ray_color(scattered, world, depth-1);
+    // Scale image and display, releasing the previous one (previews replace it often)
+    Fl_Image* scaled_img = rgb_img->copy(draw_w, draw_h);
+    delete rgb_img;
+    Fl_Image* old_img = display_box->image();
+    display_box->label("");              // Hide "Preview Ready" text
+    display_box->image(scaled_img);      // Set to display box
+    display_box->redraw();               // Force redraw (display immediately)
+    delete old_img;
 }
 
 /**
- * @brief Convert XML data to Scene structure
+ * @brief Posts a message for the FLTK thread; the handler receives a new shared_ptr<RenderJob>*.
+ * @param must_arrive Retry while the FLTK message queue is full (used for the final message).
  */
-void convertSceneDataToRenderScene(const SceneData& data, Scene& render_scene) {
-    // Traverse all objects (including ground)
-    for (const auto& xml_obj : data.objects) {
-        std::shared_ptr<Material> mat;
-        const auto& mat_data = xml_obj.material;
-
-        // ========== Material parsing (extend point light material) ==========
-        if (mat_data.type == "matte") {
-            float r = std::stof(mat_data.properties.at("color").at("r")) / 255.0f;
-            float g = std::stof(mat_data.properties.at("color").at("g")) / 255.0f;
-            float b = std::stof(mat_data.properties.at("color").at("b")) / 255.0f;
-            mat = std::make_shared<Matte>(Color(r, g, b));
-        } else if (mat_data.type == "metal") {
-            float r = std::stof(mat_data.properties.at("color").at("r")) / 255.0f;
-            float g = std::stof(mat_data.properties.at("color").at("g")) / 255.0f;
-            float b = std::stof(mat_data.properties.at("color").at("b")) / 255.0f;
-            float fuzz = std::stof(mat_data.properties.at("fuzz").at("value"));
-            mat = std::make_shared<Metal>(Color(r, g, b), fuzz);
-        } else if (mat_data.type == "glass") {
-            float ior = std::stof(mat_data.properties.at("ior").at("value"));
-            mat = std::make_shared<Glass>(ior);
-        } else if (mat_data.type == "light") {
-            // Parse self-illumination intensity
-            float intensity = std::stof(mat_data.properties.at("intensity").at("value"));
-            mat = std::make_shared<PointLight>(Color(intensity, intensity, intensity));
-        }
-
-        // ========== Object type parsing (extend plane, parallelepiped) ==========
-        if (xml_obj.type == "sphere") {
-            // Sphere parsing (original logic)
-            float pos_x = std::stof(xml_obj.properties.at("position").at("x"));
-            float pos_y = std::stof(xml_obj.properties.at("position").at("y"));
-            float pos_z = std::stof(xml_obj.properties.at("position").at("z"));
-            float radius = std::stof(xml_obj.properties.at("radius").at("value"));
-            auto sphere = std::make_shared<Sphere>(Point3(pos_x, pos_y, pos_z), radius, mat);
-            render_scene.add(sphere);
-        } else if (xml_obj.type == "plane") {
-            // Plane parsing (ground)
-            float pos_x = std::stof(xml_obj.properties.at("position").at("x"));
-            float pos_y = std::stof(xml_obj.properties.at("position").at("y"));
-            float pos_z = std::stof(xml_obj.properties.at("position").at("z"));
-            float n_x = std::stof(xml_obj.properties.at("normal").at("x"));
-            float n_y = std::stof(xml_obj.properties.at("normal").at("y"));
-            float n_z = std::stof(xml_obj.properties.at("normal").at("z"));
-            auto plane = std::make_shared<Plane>(Point3(pos_x, pos_y, pos_z), Vec3(n_x, n_y, n_z), mat);
-            render_scene.add(plane);
-        } else if (xml_obj.type == "parallelepiped") {
-            // Parallelepiped parsing
-            float o_x = std::stof(xml_obj.properties.at("origin").at("x"));
-            float o_y = std::stof(xml_obj.properties.at("origin").at("y"));
-            float o_z = std::stof(xml_obj.properties.at("origin").at("z"));
-            float u_x = std::stof(xml_obj.properties.at("u").at("x"));
-            float u_y = std::stof(xml_obj.properties.at("u").at("y"));
-            float u_z = std::stof(xml_obj.properties.at("u").at("z"));
-            float v_x = std::stof(xml_obj.properties.at("v").at("x"));
-            float v_y = std::stof(xml_obj.properties.at("v").at("y"));
-            float v_z = std::stof(xml_obj.properties.at("v").at("z"));
-            float w_x = std::stof(xml_obj.properties.at("w").at("x"));
-            float w_y = std::stof(xml_obj.properties.at("w").at("y"));
-            float w_z = std::stof(xml_obj.properties.at("w").at("z"));
-            
-            Point3 origin(o_x, o_y, o_z);
-            Vec3 u(u_x, u_y, u_z);
-            Vec3 v(v_x, v_y, v_z);
-            Vec3 w(w_x, w_y, w_z);
-            auto para = std::make_shared<Parallelepiped>(origin, u, v, w, mat);
-            render_scene.add(para);
-        }
+void post_to_gui(Fl_Awake_Handler* handler, const std::shared_ptr<RenderJob>& job, bool must_arrive) {
+    auto* message = new std::shared_ptr<RenderJob>(job);
+    while (Fl::awake(handler, message) != 0) {
+        if (!must_arrive) { delete message; return; }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
     }
+}
 
-    // Parse camera parameters (override hard-coded values)
-    if (!data.camera.properties.empty()) {
-        // Read camera position, focal length, viewport height, aspect ratio
-        float cam_x = std::stof(data.camera.properties.at("position").at("x"));
-        float cam_y = std::stof(data.camera.properties.at("position").at("y"));
-        float cam_z = std::stof(data.camera.properties.at("position").at("z"));
-        // Store to global/external variables for camera initialization in main function
-        extern Point3 camera_origin;
-        extern float camera_focal_length;
-        extern float camera_viewport_height;
-        extern float camera_aspect_ratio;
-        
-        camera_origin = Point3(cam_x, cam_y, cam_z);
-        camera_focal_length = std::stof(data.camera.properties.at("focal_length").at("value"));
-        camera_viewport_height = std::stof(data.camera.properties.at("viewport_height").at("value"));
-        
-        // Parse aspect ratio (handle strings like 16.0/9.0)
-        std::string ar_str = data.camera.properties.at("aspect_ratio").at("value");
-        size_t div_pos = ar_str.find('/');
-        if (div_pos != std::string::npos) {
-            float num = std::stof(ar_str.substr(0, div_pos));
-            float den = std::stof(ar_str.substr(div_pos+1));
-            camera_aspect_ratio = num / den;
-        } else {
-            camera_aspect_ratio = std::stof(ar_str);
-        }
+/**
+ * @brief FLTK-thread handler of a job's progress message: progress bar and partial image.
+ */
+void on_render_update(void* data) {
+    std::unique_ptr<std::shared_ptr<RenderJob>> message(static_cast<std::shared_ptr<RenderJob>*>(data));
+    const std::shared_ptr<RenderJob>& job = *message;
+    if (job != current_job || job->cancel) return; // Stale message
+
+    // Progress in samples: finished passes plus the finished fraction of the current one
+    int finished = job->completed_tiles.load(std::memory_order_relaxed);
+    int samples_done = job->samples_done.load(std::memory_order_relaxed);
+    float samples = samples_done;
+    int total_tiles = job->total_tiles.load(std::memory_order_relaxed);
+    if (total_tiles > 0) samples += (float)job->pass_samples.load(std::memory_order_relaxed) * finished / total_tiles;
+    if (app_state.progress_bar && job->samples_per_pixel > 0) {
+        app_state.progress_bar->value(samples / job->samples_per_pixel * 100.0f);
     }
-
-    // Parse global settings (background color)
-    if (!data.global_settings.properties.empty()) {
-        // Read background color and replace hard-coded value in ray_color
-        extern Color bg_color;
-        float bg_r = std::stof(data.global_settings.properties.at("background_color").at("r")) / 255.0f;
-        float bg_g = std::stof(data.global_settings.properties.at("background_color").at("g")) / 255.0f;
-        float bg_b = std::stof(data.global_settings.properties.at("background_color").at("b")) / 255.0f;
-        bg_color = Color(bg_r, bg_g, bg_b);
+    if (job->progressive) {
+        std::stringstream ss;
+        ss << "Progressive rendering: " << samples_done << "/" << job->samples_per_pixel << " spp";
+        set_status(ss.str(), FL_BLUE);
     }
-}
 
-std::atomic<int> completed_lines(0); // Atomic variable to count completed lines, no mutex needed
-std::vector<Pixel> pixel_buffer;     // Pixel buffer (stores all pixel colors)
+    std::lock_guard<std::mutex> lock(job->preview_mutex);
+    show_rgb_image(job->preview.data(), job->image_width, job->image_height);
+}
 
 /**
- * @brief OMP parallel line rendering function
+ * @brief Makes the job's image the render result (displayed, and saved by Save PNG)
+ * @return false if the GUI buffer could not be allocated
  */
-void render_omp(const Scene& render_scene,
-                const Point3& origin, const Vec3& horizontal, const Vec3& vertical,
-                const Point3& lower_left_corner,
-                int image_width, int image_height,
-                int samples_per_pixel, int max_depth,
-                std::vector<Pixel>& pixel_buffer,
-                std::atomic<int>& completed_lines) {
-    
-    // Fix: Move schedule clause after for directive, parallel only creates parallel region
-    #pragma omp parallel
-    {
-        // Only main thread initializes progress (optional)
-        #pragma omp master
-        {
-            std::cerr << "\rScanlines completed: 0/" << image_height << ' ' << std::flush;
-        }
+bool publish_result(const RenderJob& job) {
+    size_t bytes = job.preview.size();
+    void* buffer = malloc(bytes);
+    if (!buffer) {
+        fl_alert("GUI render buffer allocation failed!");
+        return false;
+    }
+    memcpy(buffer, job.preview.data(), bytes);
+    if (app_state.render_buffer) free(app_state.render_buffer);
+    app_state.render_buffer = buffer;
+    app_state.buffer_width = job.image_width;
+    app_state.buffer_height = job.image_height;
+    app_state.spp_heatmap = job.spp_heatmap; // Empty unless the render was adaptive
+    app_state.is_rendered = true;
+    show_rgb_image((unsigned char*)app_state.render_buffer, job.image_width, job.image_height);
+    return true;
+}
 
-        #pragma omp for collapse(1) schedule(dynamic, 32)
-        for (int j = 0; j < image_height; ++j) {
-            int original_j = image_height - 1 - j;
-            for (int i = 0; i < image_width; ++i) {
-                Color pixel_color(0,0,0);
-                for (int s = 0; s < samples_per_pixel; ++s) {
-                    auto u = (i + random_double()) / (image_width-1);
-                    auto v = (original_j + random_double()) / (image_height-1);
-                    Ray r(origin, lower_left_corner + u*horizontal + v*vertical - origin);
-                    pixel_color += ray_color(r, render_scene, max_depth);
-                }
-                auto scale = 1.0 / samples_per_pixel;
-                auto r = sqrt(pixel_color.x() * scale);
-                auto g = sqrt(pixel_color.y() * scale);
-                auto b = sqrt(pixel_color.z() * scale);
-                int ir = static_cast<int>(256 * clamp(r, 0.0, 0.999));
-                int ig = static_cast<int>(256 * clamp(g, 0.0, 0.999));
-                int ib = static_cast<int>(256 * clamp(b, 0.0, 0.999));
-                size_t idx = j * image_width + i;
-                pixel_buffer[idx] = {ir, ig, ib};
-            }
-            // Atomically update progress
-            int current_finished = completed_lines.fetch_add(1, std::memory_order_relaxed);
-            // Suggestion: Update UI every ~2% progress completion instead of restricting to a specific thread
-            if (current_finished % 10 == 0 || current_finished == image_height) {
-                // Although any thread can enter here, Fl::check() is best in main thread or via Fl::awake()
-                // In simple FLTK structure, omp master or thread 0 check is safe:
-                if (omp_get_thread_num() == 0) {
-                    if (app_state.progress_bar) {
-                        float progress_val = (float)current_finished / image_height * 100.0f;
-                        app_state.progress_bar->value(progress_val);
-                    }
-                    // Only thread 0 is responsible for refreshing UI and handling click events
-                    Fl::check(); 
-                    
-                    // Terminal output
-                    std::cerr << "\rScanlines completed: " << current_finished 
-                              << "/" << image_height << ' ' << std::flush;
-                }
-            }
+/**
+ * @brief FLTK-thread handler of a job's final message: final image, status, and joining the worker.
+ */
+void on_render_done(void* data) {
+    std::unique_ptr<std::shared_ptr<RenderJob>> message(static_cast<std::shared_ptr<RenderJob>*>(data));
+    const std::shared_ptr<RenderJob>& job = *message;
+    if (job != current_job) return; // Replaced by a newer job, which already joined it
+
+    if (job->worker.joinable()) job->worker.join();
+
+    if (!job->error.empty()) {
+        set_status("Scene parsing failed", FL_RED);
+        fl_alert("Scene parsing failed: %s", job->error.c_str());
+    } else if (job->cancel && job->progressive && job->samples_done > 0) {
+        // Stopped progressive render: the accumulated image is a valid (noisier) result
+        if (!publish_result(*job)) return;
+        if (app_state.progress_bar) app_state.progress_bar->label("Stopped");
+        std::stringstream ss;
+        ss << "Render stopped at " << job->samples_done << " spp after " << std::fixed << std::setprecision(3) << job->seconds << "s";
+        set_status(ss.str(), FL_DARK_GREEN);
+    } else if (job->cancel) {
+        if (app_state.progress_bar) app_state.progress_bar->label("Cancelled");
+        set_status("Render cancelled", FL_RED);
+    } else {
+        // Write rendering results to GUI's global buffer (used by Save PNG)
+        if (!publish_result(*job)) return;
+
+        if (app_state.progress_bar) {
+            app_state.progress_bar->value(100);
+            app_state.progress_bar->label("Done");
         }
 
-        // Main thread outputs final progress after parallel execution
-        #pragma omp master
-        {
-            std::cerr << "\rScanlines completed: " << image_height << "/" << image_height << " ✔️\n";
-        }
+        // Format time consumption information
+        std::stringstream ss;
+        ss << "Render completed in " << std::fixed << std::setprecision(3) << job->seconds << "s";
+        set_status(ss.str(), FL_DARK_GREEN);
     }
+
+    current_job.reset();
 }
 
 /**
- * @brief Read scene from XML file selected by GUI, execute rendering, and write results to GUI's render buffer
+ * @brief Read scene from the job's XML file and render it (runs on the job's worker thread)
  */
-double gui_render_logic(const std::string& xml_path) {
-    // Parse XML scene file
-    SceneXMLParser parser;
-    SceneData parsed_data;
+void run_render_job(std::shared_ptr<RenderJob> job) {
+    // Acceleration structure over the scene (replaces the linear object scan)
+    // RT_ACCEL=bvh2 (default) or RT_ACCEL=bvh4 selects the binary or the 4-wide BVH
+    AcceleratorType accel_type = AcceleratorType::Binary;
+    if (const char* accel_env = std::getenv("RT_ACCEL")) {
+        try {
+            accel_type = parse_accelerator_type(accel_env);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << ", using " << accelerator_name(accel_type) << "\n";
+        }
+    }
+
+    // Load the scene: materials, emissive spheres (sampled explicitly at every diffuse bounce),
+    // acceleration structure, camera and background. If the XML file has not changed since it
+    // was last rendered, everything is reloaded from its compiled cache instead of being rebuilt
+    CompiledScene scene;
     try {
-        parsed_data = parser.parseFile(xml_path);
-        std::cerr << "Scene parsed successfully: " << xml_path << ", total " << parsed_data.objects.size() << " objects\n";
+        scene = SceneCache::load(job->xml_path, accel_type, std::cerr);
     } catch (const std::exception& e) {
-        fl_alert("Scene parsing failed: %s", e.what());
-        return 0;
+        job->error = e.what();
+        post_to_gui(on_render_done, job, true);
+        return;
     }
-
-    // Build render scene
-    Scene render_scene;
-    convertSceneDataToRenderScene(parsed_data, render_scene);
+    std::cerr << "Acceleration structure: " << accelerator_name(accel_type) << "\n";
+
+    // Sample generator: RT_SAMPLER=independent, stratified, sobol (default) or bluenoise
+    SamplerType sampler_type = SamplerType::Sobol;
+    if (const char* sampler_env = std::getenv("RT_SAMPLER")) {
+        try {
+            sampler_type = parse_sampler_type(sampler_env);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << ", using " << sampler_name(sampler_type) << "\n";
+        }
+    }
+    std::cerr << "Sampler: " << sampler_name(sampler_type) << "\n";
+
+    // Render engine: RT_ENGINE=megakernel (default, depth-first) or wavefront (breadth-first batches)
+    RenderEngine engine = RenderEngine::Megakernel;
+    if (const char* engine_env = std::getenv("RT_ENGINE")) {
+        try {
+            engine = parse_render_engine(engine_env);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << ", using " << render_engine_name(engine) << "\n";
+        }
+    }
+    std::cerr << "Render engine: " << render_engine_name(engine) << "\n";
 
     // Image/camera parameters
     const int image_width = 400;
     const int samples_per_pixel = 400;
     const int max_depth = 50;
-    float aspect_ratio = camera_aspect_ratio;
-    int image_height = static_cast<int>(image_width / aspect_ratio);
-    float viewport_width = aspect_ratio * camera_viewport_height;
-    Point3 origin = camera_origin;
-    Vec3 horizontal = Vec3(viewport_width, 0, 0);
-    Vec3 vertical = Vec3(0, camera_viewport_height, 0);
-    Point3 lower_left_corner = origin - horizontal/2 - vertical/2 - Vec3(0, 0, camera_focal_length);
-
-    // Initialize pixel buffer
-    pixel_buffer.resize(image_width * image_height);
-    completed_lines.store(0, std::memory_order_relaxed);
-    int block_size = 32;
-
-    // Multi-threaded rendering (reuse original logic)
-    auto render_start = std::chrono::high_resolution_clock::now();
-
-    // Set OMP thread count (optional, default is hardware core count)
-    omp_set_num_threads(std::thread::hardware_concurrency() ?: 4);
-    // Execute OMP parallel rendering
-    render_omp(render_scene,
-               origin, horizontal, vertical,
-               lower_left_corner,
-               image_width, image_height,
-               samples_per_pixel, max_depth,
-               pixel_buffer,
-               completed_lines);
+    const int rr_min_depth = 3; // Bounces before Russian roulette may end a path
+    Viewport view = make_viewport(scene.cam_config, image_width);
+    int image_height = view.image_height;
 
-    // Calculate rendering time consumption
-    auto render_end = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double> render_duration = render_end - render_start;
-    double seconds = render_duration.count();
-
-    // Write rendering results to GUI's global buffer (replace GUI's simulated data)
-    app_state.buffer_width = image_width;
-    app_state.buffer_height = image_height;
-    // Release original buffer (avoid memory leak)
-    if (app_state.render_buffer) free(app_state.render_buffer);
-    // Allocate new buffer (RGB format, 3 bytes per pixel)
-    app_state.render_buffer = malloc(image_width * image_height * 3);
-    if (!app_state.render_buffer) {
-        fl_alert("GUI render buffer allocation failed!");
-        return 0;
-    }
+    std::unique_ptr<Sampler> sampler = make_sampler(sampler_type, samples_per_pixel);
 
-    // Copy pixel data to GUI buffer
-    unsigned char* gui_buf = (unsigned char*)app_state.render_buffer;
-    int idx = 0;
-    for (const auto& pixel : pixel_buffer) {
-        gui_buf[idx++] = static_cast<unsigned char>(pixel.r);
-        gui_buf[idx++] = static_cast<unsigned char>(pixel.g);
-        gui_buf[idx++] = static_cast<unsigned char>(pixel.b);
-    }
+    // Initialize the accumulation film and the preview shown while rendering (dark until tiles arrive)
+    Film film(image_width, image_height);
+    job->image_width = image_width;
+    job->image_height = image_height;
+    job->samples_per_pixel = samples_per_pixel;
+    job->preview.assign(image_width * image_height * 3, 0);
+
+    // Thread count (default is hardware core count)
+    int num_threads = std::thread::hardware_concurrency() ?: 4;
+
+    // Every finished tile is resolved into the preview; a GUI update is posted at most every 100 ms
+    auto render_start = std::chrono::steady_clock::now();
+    auto progress = [&](const Tile& tile, int finished, int total) {
+        {
+            std::lock_guard<std::mutex> lock(job->preview_mutex);
+            film.write_rgb(tile.x0, tile.y0, tile.x1, tile.y1, job->preview.data());
+        }
 
-    // Display rendering results to GUI's display box
-    if (app_state.render_display_box && app_state.render_buffer) {
-        // Convert to FLTK RGB image (3 bytes per pixel)
-        Fl_RGB_Image* rgb_img = new Fl_RGB_Image(
-            (unsigned char*)app_state.render_buffer,
-            image_width,
-            image_height,
-            3 // RGB format (no Alpha channel)
-        );
-
-        // Adaptive scaling (maintain aspect ratio, fit display box)
-        Fl_Box* display_box = app_state.render_display_box;
-        int box_w = display_box->w();
-        int box_h = display_box->h();
-        float img_aspect = (float)image_width / image_height;
-        float box_aspect = (float)box_w / box_h;
-        int draw_w, draw_h;
-
-        if (img_aspect > box_aspect) {
-            // Image is wider, scale by display box width
-            draw_w = box_w;
-            draw_h = static_cast<int>(box_w / img_aspect);
+        long long now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - render_start).count();
+        long long next = job->next_update_ns.load(std::memory_order_relaxed);
+        if (finished < total && now >= next &&
+            job->next_update_ns.compare_exchange_strong(next, now + preview_interval_ns)) {
+            post_to_gui(on_render_update, job, false);
+        }
+    };
+
+    // Adaptive sampling: the same total budget (samples_per_pixel on average), spent on the
+    // pixels that are still noisy; a pixel may get up to 8x the average
+    AdaptiveSampling adaptive;
+    adaptive.max_samples = 8 * samples_per_pixel;
+    const long long pixel_count = static_cast<long long>(image_width) * image_height;
+    const long long sample_budget = samples_per_pixel * pixel_count;
+
+    // Progressive/adaptive: passes of 1, 2, 4, ... (at most max_pass_samples) spp, progressive
+    // ones are previewed after each pass. Otherwise: a single pass with every sample.
+    int pass_samples = (job->progressive || job->adaptive) ? 1 : samples_per_pixel;
+    int passes = 0;
+    while (!job->cancel) {
+        if (job->adaptive) {
+            long long remaining = sample_budget - film.total_samples();
+            int active = film.active_pixels(adaptive);
+            if (remaining <= 0 || active == 0) break;
+            pass_samples = static_cast<int>(std::clamp<long long>(remaining / active, 1, pass_samples));
+            job->pass_samples = static_cast<int>(pass_samples * active / pixel_count);
         } else {
-            // Image is taller, scale by display box height
-            draw_h = box_h;
-            draw_w = static_cast<int>(box_h * img_aspect);
+            if (job->samples_done >= samples_per_pixel) break;
+            pass_samples = std::min(pass_samples, samples_per_pixel - job->samples_done);
+            job->pass_samples = pass_samples;
+        }
+        job->completed_tiles = 0;
+
+        // Multi-threaded tile rendering: this thread is thread 0, all threads trace
+        TileScheduler scheduler(image_width, image_height, num_threads);
+        job->total_tiles = static_cast<int>(scheduler.tile_count());
+        render_tiles(num_threads,
+                     scheduler,
+                     *scene.world,
+                     scene.materials,
+                     scene.lights,
+                     view.origin, view.horizontal, view.vertical,
+                     view.lower_left_corner,
+                     image_width, image_height,
+                     pass_samples, max_depth, rr_min_depth,
+                     scene.bg_color,
+                     film,
+                     job->completed_tiles,
+                     progress,
+                     &job->cancel,
+                     job->adaptive ? &adaptive : nullptr,
+                     sampler.get(),
+                     engine);
+        if (job->cancel) break;
+
+        // Average spp for adaptive sampling
+        job->samples_done = job->adaptive ? static_cast<int>(film.total_samples() / pixel_count)
+                                          : job->samples_done + pass_samples;
+        ++passes;
+        if (!job->progressive && !job->adaptive) {
+            scheduler.print_report(std::cerr);
+        } else if (job->progressive) {
+            // Preview of the whole image after each pass
+            {
+                std::lock_guard<std::mutex> lock(job->preview_mutex);
+                film.write_rgb(job->preview.data());
+            }
+            post_to_gui(on_render_update, job, false);
         }
+        pass_samples = std::min(2 * pass_samples, max_pass_samples);
+    }
 
-        // ③ Scale image and display
-        Fl_Image* scaled_img = rgb_img->copy(draw_w, draw_h);
-        delete rgb_img;                      // Release original image (avoid memory leak)
-        display_box->label("");              // Hide "Preview Ready" text
-        display_box->image(scaled_img);      // Set to display box
-        display_box->redraw();               // Force redraw (display immediately)
+    // Final image (also covers the tiles a cancellation interrupted)
+    {
+        std::lock_guard<std::mutex> lock(job->preview_mutex);
+        film.write_rgb(job->preview.data());
     }
 
-    app_state.is_rendered = true;
+    // Calculate rendering time consumption
+    std::chrono::duration<double> render_duration = std::chrono::steady_clock::now() - render_start;
+    job->seconds = render_duration.count();
+    if (!job->cancel) {
+        std::cerr << "Render completed in " << job->seconds << "s";
+        if (job->progressive || job->adaptive) std::cerr << " (" << passes << " passes)";
+        std::cerr << "\n";
+    }
 
-    return seconds;
+    // Where the adaptive samples went: statistics and a heatmap (blue = few samples, white = the cap)
+    if (job->adaptive && !job->cancel) {
+        int min_spp = adaptive.max_samples, max_spp = 0;
+        for (int j = 0; j < image_height; ++j) {
+            for (int i = 0; i < image_width; ++i) {
+                min_spp = std::min(min_spp, film.samples(i, j));
+                max_spp = std::max(max_spp, film.samples(i, j));
+            }
+        }
+        int active = film.active_pixels(adaptive);
+        std::cerr << "Adaptive sampling: " << film.total_samples() << " samples, spp min " << min_spp
+                  << " avg " << static_cast<double>(film.total_samples()) / pixel_count << " max " << max_spp
+                  << ", " << (pixel_count - active) * 100.0 / pixel_count << "% of pixels converged\n";
+
+        // Saved next to the image by Save PNG
+        job->spp_heatmap.resize(pixel_count * 3);
+        film.write_spp_heatmap(adaptive.max_samples, job->spp_heatmap.data());
+    }
+
+    post_to_gui(on_render_done, job, true);
+}
 
+/**
+ * @brief Cancels the current job, if any, and waits for its threads (at most one 8x8 pixel block each)
+ */
+void stop_current_job() {
+    if (!current_job) return;
+    current_job->cancel = true;
+    if (current_job->worker.joinable()) current_job->worker.join();
+    current_job.reset(); // Its queued messages are now stale
 }
 
 /**
- * @brief Override GUI's render callback
+ * @brief Override GUI's render callback: starts a render in the background, replacing any running one
  */
 void custom_render_cb(Fl_Widget*, void*) {
     if (app_state.selected_file.empty()) {
@@ -378,35 +423,36 @@ void custom_render_cb(Fl_Widget*, void*) {
         return;
     }
 
-    // 1. Set rendering status
-    set_status("Rendering scene, please wait...", FL_BLUE);
+    // 1. Re-render: the running job stops within one 8x8 pixel block
+    stop_current_job();
 
-    // 1. Reset progress bar
+    // 2. Reset progress bar and status
     if (app_state.progress_bar) {
         app_state.progress_bar->value(0);
         app_state.progress_bar->label("Rendering...");
     }
-    
     set_status("Rendering scene, please wait...", FL_BLUE);
-    
-    // 2. Execute rendering (progress_bar->value update will be triggered internally)
-    double elapsed_seconds = gui_render_logic(app_state.selected_file);
 
-    // 3. Post-rendering processing
-    if (app_state.progress_bar) {
-        app_state.progress_bar->value(100);
-        app_state.progress_bar->label("Done");
-    }
+    // 3. Start rendering on a background thread; the GUI stays responsive
+    current_job = std::make_shared<RenderJob>();
+    current_job->xml_path = app_state.selected_file;
+    current_job->progressive = app_state.progressive_check && app_state.progressive_check->value();
+    current_job->adaptive = app_state.adaptive_check && app_state.adaptive_check->value();
+    current_job->worker = std::thread(run_render_job, current_job);
+}
 
-    // 3. Format time consumption information
-    std::stringstream ss;
-    ss << "Render completed in " << std::fixed << std::setprecision(3) << elapsed_seconds << "s";
-    
-    // 4. Update status bar
-    set_status(ss.str(), FL_DARK_GREEN);
-    
-    // 5. Force window refresh to display final status
-    app_state.render_display_box->window()->redraw();
+/**
+ * @brief Override GUI's cancel callback: stops the running render, keeping the partial image
+ */
+void custom_cancel_cb(Fl_Widget*, void*) {
+    if (!current_job) {
+        set_status("Nothing to cancel", FL_YELLOW);
+        return;
+    }
+    // The worker notices within one 8x8 pixel block and posts its final message
+    // (a progressive render keeps the samples accumulated so far)
+    current_job->cancel = true;
+    set_status("Cancelling...", FL_YELLOW);
 }
 
 /**
@@ -472,20 +518,18 @@ int main() {
     app_state.file_browser->callback(browser_cb);
     refresh_scene_list("../scene");
 
-    // Rebind button logic
-    Fl_Button* refresh_btn = (Fl_Button*)main_win->child(4);     // Refresh list button
-    Fl_Button* render_btn = (Fl_Button*)main_win->child(5);      // Render button
-    Fl_Button* save_btn = (Fl_Button*)main_win->child(6);        // Save PNG button
-    
-    // Replace GUI's default callback functions (use custom logic)
-    refresh_btn->callback(refresh_btn_wrapper);
-    render_btn->callback(custom_render_cb);      // Custom rendering logic (real rendering)
+    // Replace GUI's default callback functions (use custom logic); the Save button keeps save_png_cb
+    app_state.refresh_button->callback(refresh_btn_wrapper);
+    app_state.render_button->callback(custom_render_cb);  // Custom rendering logic (real rendering, in the background)
+    app_state.cancel_button->callback(custom_cancel_cb);  // Stops the background render
 
     // ========== Start GUI main loop ==========
+    Fl::lock(); // Enables Fl::awake() messages from the render thread
     main_win->show();
     int ret = Fl::run();
 
     // ========== Clean up resources ==========
+    stop_current_job(); // The window was closed while rendering
     cleanup_resources(main_win);
     return ret;
 }
\ No newline at end of file